@@ -0,0 +1,248 @@
+#ifndef SEGMENT_TREE_CONCURRENT_SEGMENT_TREE_H
+#define SEGMENT_TREE_CONCURRENT_SEGMENT_TREE_H
+#include "operations.h"
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <type_traits>
+#include <utility>
+namespace st
+{
+/*
+CLASS SUMMARY
+
+	template <typename T, typename Op = Sum<T>>
+	class ConcurrentSegmentTree;
+
+	// Constructors / Destructors.
+	ConcurrentSegmentTree();
+	ConcurrentSegmentTree(const T *input, int n);
+	ConcurrentSegmentTree(_InputIterator first, _InputIterator last);
+	~ConcurrentSegmentTree();
+
+	// Capacity
+	bool empty() const;
+	int size() const;
+
+	// Specialized algorithms.
+	T sum(int queryLeft, int queryRight) const;		// Any number of reader threads.
+	void update(int index, T newVal);				// One writer thread at a time.
+	void update_batch(const std::pair<int, T> *updates, int count);
+	unsigned long version() const;
+*/
+
+/**
+ *  @brief  Segment tree with one writer and any number of readers that never block.
+ *
+ *  Nodes follow BottomUpLayout, leaf i at n + i and the parent of i at i / 2, and are
+ *  atomics read and written without ordering. A sequence lock orders them: the writer
+ *  makes version_ odd while it changes nodes and even again when done, and a reader
+ *  retries a query that overlapped a write. So a sum is always the sum of one version of
+ *  the elements, never of a half updated path. The writer never waits for readers.
+ *
+ *  T must be trivially copyable, as it is read and written through std::atomic<T>.
+ */
+template <typename T, typename Op = Sum<T>>
+class ConcurrentSegmentTree
+{
+	static_assert(std::is_trivially_copyable<T>::value, "ConcurrentSegmentTree needs a trivially copyable type");
+
+private:
+	// Underlying data structure for the segment tree, 2 * n_ nodes.
+	std::atomic<T> *tree_;
+	int n_;
+	// Odd while the writer is changing nodes.
+	std::atomic<unsigned long> version_;
+
+public:
+	// Constructors/Destructors.
+
+	/**
+	 *  @brief  Creates a Segment Tree with no elements.
+	 */
+	explicit ConcurrentSegmentTree() : tree_(nullptr), n_(0), version_(0) {}
+
+	ConcurrentSegmentTree(const ConcurrentSegmentTree &) = delete;
+	ConcurrentSegmentTree &operator=(const ConcurrentSegmentTree &) = delete;
+
+	/**
+	 *  @brief  Creates a segment tree from an input array.
+	 *  @param  input	Input array whose elements are used to build the segment tree.
+	 *  @param  n	Number of elements of input array to use.
+	 *
+	 *  This is linear in N.
+	 */
+	ConcurrentSegmentTree(const T *input, int n) : tree_(new std::atomic<T>[2 * n]), n_(n), version_(0)
+	{
+		for (int i = 0; i < n; ++i)
+		{
+			tree_[n + i].store(input[i], std::memory_order_relaxed);
+		}
+		build();
+	}
+
+	/**
+	 *  @brief  Builds a segment tree from a range.
+	 *  @param  first	An input iterator.
+	 *  @param  last	An input iterator.
+	 *
+	 *  This is linear in N.
+	 */
+	template <typename _InputIterator>
+	ConcurrentSegmentTree(_InputIterator first, _InputIterator last) : tree_(new std::atomic<T>[2 * (last - first)]), n_(last - first), version_(0)
+	{
+		for (int i = n_; first != last; ++first, ++i)
+		{
+			tree_[i].store(*first, std::memory_order_relaxed);
+		}
+		build();
+	}
+
+	/**
+	 *  @brief  Destructor for segment tree.
+	 */
+	~ConcurrentSegmentTree()
+	{
+		delete[] tree_;
+		n_ = 0;
+	}
+
+	///  Returns true if the SegmentTree is empty.
+	bool empty() const { return n_ == 0; }
+
+	///  Returns the size of the SegmentTree.
+	int size() const { return n_; }
+
+	///  Returns the number of completed writes times two, odd while a write is in progress.
+	unsigned long version() const { return version_.load(std::memory_order_acquire); }
+
+	/**
+	 *  @brief	Finds sum of consecutive elements in a range [queryLeft,queryRight).
+	 *  @param	queryLeft	Left index of range for which sum has to be found.
+	 *  @param	queryRight	Right index of range (Non-inclusive) for which sum has to be found.
+	 *  @return	Sum of range of consecutive elements from [queryLeft, queryRight)
+	 *
+	 *  Safe to call from any number of threads while one thread updates the tree.
+	 *  The query is repeated if a write happened while it read the nodes.
+	 *  Takes O(logN) time when no write overlaps it.
+	 */
+	T sum(int queryLeft, int queryRight) const
+	{
+		if (n_ <= 0 || queryLeft >= queryRight)
+			return Op::identity();
+		for (;;)
+		{
+			unsigned long before = version_.load(std::memory_order_acquire);
+			if (before & 1)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+			T result = sum_nodes(queryLeft, queryRight);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (version_.load(std::memory_order_relaxed) == before)
+				return result;
+		}
+	}
+
+	/**
+	 *  @brief 	Modify a specific element in the tree.
+	 *  @param  index	Index of element to be updated.
+	 *  @param  newVal	New value of the element.
+	 *
+	 *  Only one thread may write at a time. Readers see the tree before or after the update.
+	 *  Takes O(logN) time.
+	 */
+	void update(int index, T newVal)
+	{
+		if (index >= 0 && index < n_)
+		{
+			begin_write();
+			update_path(index, newVal);
+			end_write();
+		}
+	}
+
+	/**
+	 *  @brief 	Modify a batch of elements in the tree as one write.
+	 *  @param  updates	Array of count pairs of index and new value.
+	 *  @param  count	Number of updates.
+	 *
+	 *  Readers see either none or all of the batch, so a batch can move a quantity between
+	 *  elements without a reader ever seeing it in both or neither. Updates with an index
+	 *  outside the tree are ignored.
+	 *  Takes O(K logN) time.
+	 */
+	void update_batch(const std::pair<int, T> *updates, int count)
+	{
+		begin_write();
+		for (int i = 0; i < count; ++i)
+		{
+			if (updates[i].first >= 0 && updates[i].first < n_)
+				update_path(updates[i].first, updates[i].second);
+		}
+		end_write();
+	}
+
+private:
+	/**
+	 *  @brief  Computes every internal node from its children.
+	 */
+	void build()
+	{
+		for (int i = n_ - 1; i > 0; --i)
+		{
+			tree_[i].store(Op::combine(tree_[2 * i].load(std::memory_order_relaxed), tree_[2 * i + 1].load(std::memory_order_relaxed)),
+						   std::memory_order_relaxed);
+		}
+	}
+
+	/**
+	 *  @brief  Bottom-up sum of the nodes, as in BottomUpLayout::sum.
+	 */
+	T sum_nodes(int queryLeft, int queryRight) const
+	{
+		T resultLeft = Op::identity(), resultRight = Op::identity();
+		for (queryLeft += n_, queryRight += n_; queryLeft < queryRight; queryLeft >>= 1, queryRight >>= 1)
+		{
+			if (queryLeft & 1)
+				resultLeft = Op::combine(resultLeft, tree_[queryLeft++].load(std::memory_order_relaxed));
+			if (queryRight & 1)
+				resultRight = Op::combine(tree_[--queryRight].load(std::memory_order_relaxed), resultRight);
+		}
+		return Op::combine(resultLeft, resultRight);
+	}
+
+	/**
+	 *  @brief  Writes an element and recomputes its ancestors.
+	 */
+	void update_path(int index, const T &newVal)
+	{
+		int i = n_ + index;
+		tree_[i].store(newVal, std::memory_order_relaxed);
+		for (i /= 2; i > 0; i /= 2)
+		{
+			tree_[i].store(Op::combine(tree_[2 * i].load(std::memory_order_relaxed), tree_[2 * i + 1].load(std::memory_order_relaxed)),
+						   std::memory_order_relaxed);
+		}
+	}
+
+	/**
+	 *  @brief  Makes the version odd before any node is changed.
+	 */
+	void begin_write()
+	{
+		version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	/**
+	 *  @brief  Makes the version even again once every node is changed.
+	 */
+	void end_write()
+	{
+		version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+};
+} // namespace st
+#endif // SEGMENT_TREE_CONCURRENT_SEGMENT_TREE_H
@@ -0,0 +1,305 @@
+#ifndef SEGMENT_TREE_FENWICK_TREE_H
+#define SEGMENT_TREE_FENWICK_TREE_H
+#include "iterator.h"
+#include "operations.h"
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+namespace st
+{
+/*
+CLASS SUMMARY
+
+	template <typename T, typename Op = Sum<T>>
+	class FenwickTree;
+
+	A drop-in backend for SegmentTree<T, Op> when only sum() and update() are needed, T is
+	integral and Op is invertible (Sum or BitXor, see ExactInverse in operations.h):
+
+	typedef st::FenwickTree<long> Totals;		// instead of st::SegmentTree<long>
+
+	// Constructors.
+	FenwickTree();
+	FenwickTree(const T *input, int n);
+	FenwickTree(_InputIterator first, _InputIterator last);
+
+	// Iterators.
+	iterator begin();
+	iterator end();
+	reverse_iterator rbegin();
+	reverse_iterator rend();
+	// Each also has a const overload returning const_iterator or const_reverse_iterator.
+
+	// Operations - Standard algorithms.
+	int count(const T &val) const;
+	iterator find(const T val);
+	iterator lower_bound(const T &val);
+	iterator upper_bound(const T &val);
+	std::pair<iterator, iterator> equal_range(const T &val);
+	// Each also has a const overload returning const_iterator.
+
+	// Capacity
+	bool empty() const;
+	int size() const;
+	std::size_t memory_footprint() const;
+
+	// Specialized algorithms.
+	T sum(int queryLeft, int queryRight) const;
+	void update(int index, T newVal);
+*/
+
+/**
+ *  @brief  Fenwick (binary indexed) tree with the interface of SegmentTree.
+ *
+ *  Node k - 1 holds the sum of the elements [k - lowbit(k), k), for k in 1 .. n, so the
+ *  nodes take n slots where RecursiveLayout takes up to 4n. A prefix [0, r) is the sum of
+ *  the nodes met while clearing the lowest set bit of r, and a range [l, r) walks r and l
+ *  down together until they meet, taking the nodes of l back out with Op::inverse.
+ *  update() adds the difference between the new and the old value to the nodes covering
+ *  the element, which is why Op must be invertible. The walks mix the order of the
+ *  elements, so Op must also be commutative.
+ *
+ *  T must be integral, as ExactInverse<T, Op> requires. A floating point range taken out
+ *  of a larger prefix loses the low bits the prefix had no room for, and every update()
+ *  leaves the rounding of its difference in the nodes for good, so float sums would drift
+ *  away from those of SegmentTree; use SegmentTree for them. Nodes of Sum over a signed T
+ *  are kept unsigned, so they may wrap around while every range that fits in T stays exact.
+ *
+ *  A copy of the elements is kept for the iterators and for update(), so the tree uses
+ *  2n slots in all.
+ */
+template <typename T, typename Op = Sum<T>>
+class FenwickTree
+{
+	static_assert(ExactInverse<T, Op>::value, "FenwickTree needs an integral type and an operation with an inverse");
+
+public:
+	// Iterator-related typedefs.
+	typedef Iterator<T> iterator;
+	typedef ReverseIterator<T> reverse_iterator;
+	typedef Iterator<const T> const_iterator;
+	typedef ReverseIterator<const T> const_reverse_iterator;
+
+private:
+	typedef typename ExactInverse<T, Op>::type Node;
+	typedef typename ExactInverse<T, Op>::op NodeOp;
+
+	// Elements, as given or updated.
+	std::vector<T> cont_;
+	// Fenwick nodes, n_ of them.
+	std::vector<Node> tree_;
+	int n_;
+
+public:
+	// Constructors.
+
+	/**
+	 *  @brief  Creates a Fenwick Tree with no elements.
+	 */
+	explicit FenwickTree() : n_(0) {}
+
+	/**
+	 *  @brief  Creates a Fenwick tree from an input array.
+	 *  @param  input	Input array whose elements are used to build the tree.
+	 *  @param  n	Number of elements of input array to use.
+	 *
+	 *  This is linear in N.
+	 */
+	FenwickTree(const T *input, int n) : cont_(input, input + std::max(n, 0)), n_(cont_.size())
+	{
+		build();
+	}
+
+	/**
+	 *  @brief  Builds a Fenwick tree from a range.
+	 *  @param  first	An input iterator.
+	 *  @param  last	An input iterator.
+	 *
+	 *  This is linear in N.
+	 */
+	template <typename _InputIterator>
+	FenwickTree(_InputIterator first, _InputIterator last) : cont_(first, last), n_(cont_.size())
+	{
+		build();
+	}
+
+	/**
+	 *  Returns an iterator referring to the first element in the container.
+	 */
+	iterator begin() { return iterator(cont_.data()); }
+
+	/**
+	 * Returns an iterator that points one past the last element in the container.
+	 */
+	iterator end() { return iterator(cont_.data() + n_); }
+
+	/**
+	 *  Returns a reverse iterator referring to the last element in the container.
+	 */
+	reverse_iterator rbegin() { return reverse_iterator(cont_.data() + n_ - 1); }
+
+	/**
+	 *  Returns a reverse iterator referring to one past the first element in the container.
+	 */
+	reverse_iterator rend() { return reverse_iterator(cont_.data() - 1); }
+
+	///  Returns a read-only iterator referring to the first element in the container.
+	const_iterator begin() const { return const_iterator(cont_.data()); }
+
+	///  Returns a read-only iterator that points one past the last element in the container.
+	const_iterator end() const { return const_iterator(cont_.data() + n_); }
+
+	///  Returns a read-only reverse iterator referring to the last element in the container.
+	const_reverse_iterator rbegin() const { return const_reverse_iterator(cont_.data() + n_ - 1); }
+
+	///  Returns a read-only reverse iterator referring to one past the first element in the container.
+	const_reverse_iterator rend() const { return const_reverse_iterator(cont_.data() - 1); }
+
+	/**
+	 *  @brief	Finds the number of elements.
+	 *  @param	val	Element to located.
+	 *  @return	Number of elements with specified val.
+	 */
+	int count(const T &val) const { return std::count(cont_.begin(), cont_.end(), val); }
+
+	/**
+	 *  @brief  Finds the first element that matches val.
+	 *  @return Iterator to an element with val equivalent to val, or end().
+	 */
+	iterator find(const T val) { return begin() + find_index(val); }
+
+	///  Read-only version of find().
+	const_iterator find(const T val) const { return begin() + find_index(val); }
+
+	/**
+	 *  @brief	Finds the beginning of a subsequence matching given val.
+	 *  @return Iterator pointing to first element equal to or greater than val, or end().
+	 */
+	iterator lower_bound(const T &val) { return begin() + lower_bound_index(val); }
+
+	///  Read-only version of lower_bound().
+	const_iterator lower_bound(const T &val) const { return begin() + lower_bound_index(val); }
+
+	/**
+	 *  @brief	Finds the end of a subsequence matching given val.
+	 *  @return Iterator pointing to the first element greater than val, or end().
+	 */
+	iterator upper_bound(const T &val) { return begin() + upper_bound_index(val); }
+
+	///  Read-only version of upper_bound().
+	const_iterator upper_bound(const T &val) const { return begin() + upper_bound_index(val); }
+
+	/**
+	 *  @brief	This is equivalent to make_pair(c.lower_bound(val), c.upper_bound(val))
+	 */
+	std::pair<iterator, iterator> equal_range(const T &val)
+	{
+		return std::make_pair(lower_bound(val), upper_bound(val));
+	}
+
+	///  Read-only version of equal_range().
+	std::pair<const_iterator, const_iterator> equal_range(const T &val) const
+	{
+		return std::make_pair(lower_bound(val), upper_bound(val));
+	}
+
+	///  Returns true if the FenwickTree is empty.
+	bool empty() const { return n_ == 0; }
+
+	///  Returns the size of the FenwickTree.
+	int size() const { return n_; }
+
+	///  Returns the number of bytes used by the elements and the nodes.
+	std::size_t memory_footprint() const { return cont_.size() * sizeof(T) + tree_.size() * sizeof(Node); }
+
+	/**
+	 *  @brief	Finds sum of consecutive elements in a range [queryLeft,queryRight).
+	 *  @param	queryLeft	Left index of range for which sum has to be found.
+	 *  @param	queryRight	Right index of range (Non-inclusive) for which sum has to be found.
+	 *  @return	Sum of range of consecutive elements from [queryLeft, queryRight)
+	 *
+	 *  The nodes below the longest common prefix of the two bounds are never read.
+	 *  Takes O(logN) time.
+	 */
+	T sum(int queryLeft, int queryRight) const
+	{
+		queryLeft = std::max(queryLeft, 0);
+		queryRight = std::min(queryRight, n_);
+		if (queryLeft >= queryRight)
+			return Op::identity();
+		Node added = NodeOp::identity(), removed = NodeOp::identity();
+		const Node *tree = tree_.data();
+		while (queryRight != queryLeft)
+		{
+			if (queryRight > queryLeft)
+			{
+				added = NodeOp::combine(added, tree[queryRight - 1]);
+				queryRight &= queryRight - 1;
+			}
+			else
+			{
+				removed = NodeOp::combine(removed, tree[queryLeft - 1]);
+				queryLeft &= queryLeft - 1;
+			}
+		}
+		return T(NodeOp::inverse(added, removed));
+	}
+
+	/**
+	 *  @brief 	Modify a specific element in the tree.
+	 *  @param  index	Index of element to be updated.
+	 *  @param  newVal	New value of the element.
+	 *
+	 *  Takes O(logN) time.
+	 */
+	void update(int index, T newVal)
+	{
+		if (index < 0 || index >= n_)
+			return;
+		Node delta = NodeOp::inverse(Node(newVal), Node(cont_[index]));
+		cont_[index] = newVal;
+		for (int k = index + 1; k <= n_; k += k & -k)
+		{
+			tree_[k - 1] = NodeOp::combine(tree_[k - 1], delta);
+		}
+	}
+
+private:
+	/**
+	 *  @brief  Computes the nodes from cont_ in O(N), each node adding itself to its parent.
+	 */
+	void build()
+	{
+		tree_.assign(cont_.begin(), cont_.end());
+		for (int k = 1; k <= n_; ++k)
+		{
+			int parent = k + (k & -k);
+			if (parent <= n_)
+				tree_[parent - 1] = NodeOp::combine(tree_[parent - 1], tree_[k - 1]);
+		}
+	}
+
+	/**
+	 *  @brief  Index of the first element equal to val, or n_.
+	 */
+	int find_index(const T &val) const { return std::find(cont_.begin(), cont_.end(), val) - cont_.begin(); }
+
+	/**
+	 *  @brief  Index of the first element not less than val, or n_.
+	 */
+	int lower_bound_index(const T &val) const
+	{
+		return std::find_if(cont_.begin(), cont_.end(), [&val](const T &x) { return !(x < val); }) - cont_.begin();
+	}
+
+	/**
+	 *  @brief  Index of the first element greater than val, or n_.
+	 */
+	int upper_bound_index(const T &val) const
+	{
+		return std::find_if(cont_.begin(), cont_.end(), [&val](const T &x) { return val < x; }) - cont_.begin();
+	}
+};
+} // namespace st
+#endif // SEGMENT_TREE_FENWICK_TREE_H
@@ -0,0 +1,292 @@
+#ifndef SEGMENT_TREE_FILE_FORMAT_H
+#define SEGMENT_TREE_FILE_FORMAT_H
+#include "layout.h"
+#include "operations.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+namespace st
+{
+/*
+FILE FORMAT SUMMARY
+
+	A saved segment tree is a 64 byte FileHeader followed by the payload:
+
+	T nodes[node_count];	// The node array of the layout, as built.
+	T elements[n];			// Only for layouts that do not store the leaves in the nodes.
+
+	Everything is written in the byte order of the machine that saved it, which the
+	endianness field records, so a file can be mapped and queried with no parsing. The
+	payload starts at offset 64, so a mapped file keeps the nodes cache line aligned.
+	SegmentTree::load reads files of the other byte order too, byte swapping arithmetic T.
+
+	The header records what the nodes mean: the size and kind of T, the layout and the
+	operation. Layouts and operations are told apart by FormatId, which is specialized for
+	the ones in layout.h and operations.h; give a custom operation an id of its own by
+	specializing FormatId for it.
+
+	checksum hashes the payload bytes as stored in the file: FNV-1a style, but on 64 bit
+	little endian words spread over four lanes, so it runs at memory speed (see
+	detail::checksum). The node array is hashed first and its hash seeds that of the elements.
+*/
+
+/**
+ *  @brief  Identifies a layout or an operation in a saved tree, 0 if it has no id.
+ */
+template <typename T>
+struct FormatId
+{
+	static constexpr std::uint32_t value = 0;
+};
+
+template <>
+struct FormatId<RecursiveLayout>
+{
+	static constexpr std::uint32_t value = 1;
+};
+
+template <>
+struct FormatId<BottomUpLayout>
+{
+	static constexpr std::uint32_t value = 2;
+};
+
+/// BlockedLayout ids carry the fan-out, as it changes the node array.
+template <int B>
+struct FormatId<BlockedLayout<B>>
+{
+	static constexpr std::uint32_t value = (3u << 16) | std::uint32_t(B);
+};
+
+template <typename T>
+struct FormatId<Sum<T>>
+{
+	static constexpr std::uint32_t value = 1;
+};
+
+template <typename T>
+struct FormatId<Min<T>>
+{
+	static constexpr std::uint32_t value = 2;
+};
+
+template <typename T>
+struct FormatId<Max<T>>
+{
+	static constexpr std::uint32_t value = 3;
+};
+
+template <typename T>
+struct FormatId<BitAnd<T>>
+{
+	static constexpr std::uint32_t value = 4;
+};
+
+template <typename T>
+struct FormatId<BitOr<T>>
+{
+	static constexpr std::uint32_t value = 5;
+};
+
+template <typename T>
+struct FormatId<BitXor<T>>
+{
+	static constexpr std::uint32_t value = 6;
+};
+
+template <typename T>
+struct FormatId<Gcd<T>>
+{
+	static constexpr std::uint32_t value = 7;
+};
+
+/**
+ *  @brief  The header at the start of a saved segment tree.
+ */
+struct FileHeader
+{
+	/// Current format version.
+	static constexpr std::uint32_t current_version = 1;
+	/// Value of endianness as written by the saving machine, read back byte swapped on the other byte order.
+	static constexpr std::uint32_t byte_order_mark = 0x01020304;
+
+	char magic[8];					// "SEGTREE" and a NUL.
+	std::uint32_t version;
+	std::uint32_t endianness;
+	std::uint32_t value_size;		// sizeof(T).
+	std::uint32_t value_kind;		// 1 signed integer, 2 unsigned integer, 3 floating point, 0 other.
+	std::uint32_t layout;			// FormatId of the layout.
+	std::uint32_t operation;		// FormatId of the operation.
+	std::uint64_t n;				// Number of elements.
+	std::uint64_t node_count;		// Number of nodes, Layout::node_count(n).
+	std::uint64_t checksum;			// detail::payload_checksum of the payload.
+	std::uint64_t reserved;
+};
+
+static_assert(sizeof(FileHeader) == 64, "FileHeader must be 64 bytes");
+
+namespace detail
+{
+/**
+ *  @brief  Seed of a checksum, the offset basis of 64 bit FNV-1a.
+ */
+inline constexpr std::uint64_t checksum_seed = 14695981039346656037ull;
+
+/**
+ *  @brief  Reads a 64 bit little endian word.
+ */
+inline std::uint64_t load_little_endian(const unsigned char *bytes)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	std::uint64_t word;
+	std::memcpy(&word, bytes, sizeof(word));
+	return word;
+#else
+	std::uint64_t word = 0;
+	for (int i = 7; i >= 0; --i)
+	{
+		word = (word << 8) | bytes[i];
+	}
+	return word;
+#endif
+}
+
+/**
+ *  @brief  Hashes bytes bytes, giving the same result on any byte order.
+ *  @param  seed	checksum_seed, or the checksum of the bytes before these.
+ *
+ *  Every 64 bit word is mixed into one of four lanes by an FNV-1a step followed by a
+ *  shift, so each lane is a chain of one multiply per word and the four chains overlap.
+ *  The lanes and the last bytes are then folded into one hash the same way.
+ */
+inline std::uint64_t checksum(const void *data, std::size_t bytes, std::uint64_t seed)
+{
+	const std::uint64_t prime = 1099511628211ull;
+	const unsigned char *first = static_cast<const unsigned char *>(data);
+	std::uint64_t lanes[4] = {seed, seed ^ 1, seed ^ 2, seed ^ 3};
+	std::size_t blocked = bytes / 32 * 32;
+	for (std::size_t i = 0; i < blocked; i += 32)
+	{
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			std::uint64_t hash = (lanes[lane] ^ load_little_endian(first + i + 8 * lane)) * prime;
+			lanes[lane] = hash ^ (hash >> 29);
+		}
+	}
+	std::uint64_t hash = seed;
+	for (std::uint64_t lane : lanes)
+	{
+		hash = (hash ^ lane) * prime;
+		hash ^= hash >> 29;
+	}
+	for (std::size_t i = blocked; i < bytes; ++i)
+	{
+		hash = (hash ^ first[i]) * prime;
+	}
+	return hash;
+}
+
+/**
+ *  @brief  Checksum of the payload of a tree of n elements, as stored in FileHeader::checksum.
+ *  @param  cont	The element array, nullptr for layouts that store the leaves in the nodes.
+ */
+template <typename T, typename Layout>
+std::uint64_t payload_checksum(const T *tree, const T *cont, int n)
+{
+	std::uint64_t hash = checksum(tree, std::size_t(Layout::node_count(n)) * sizeof(T), checksum_seed);
+	return cont ? checksum(cont, std::size_t(n) * sizeof(T), hash) : hash;
+}
+
+/**
+ *  @brief  Reverses the bytes of each of count values of size bytes.
+ */
+inline void byteswap_values(void *data, std::size_t count, std::size_t size)
+{
+	unsigned char *value = static_cast<unsigned char *>(data);
+	for (std::size_t i = 0; i < count; ++i, value += size)
+	{
+		std::reverse(value, value + size);
+	}
+}
+
+/**
+ *  @brief  Converts every field of a header read from a file of the other byte order.
+ */
+inline void byteswap_header(FileHeader &header)
+{
+	byteswap_values(&header.version, 6, sizeof(std::uint32_t));
+	byteswap_values(&header.n, 4, sizeof(std::uint64_t));
+}
+
+/**
+ *  @brief  Kind of T as recorded in FileHeader::value_kind.
+ */
+template <typename T>
+constexpr std::uint32_t value_kind()
+{
+	if (std::is_integral<T>::value)
+		return std::is_signed<T>::value ? 1 : 2;
+	return std::is_floating_point<T>::value ? 3 : 0;
+}
+
+/**
+ *  @brief  Number of payload bytes of a tree of n elements.
+ */
+template <typename T, typename Layout>
+std::uint64_t payload_size(int n)
+{
+	std::uint64_t count = Layout::node_count(n);
+	if (!Layout::stores_leaves)
+		count += n;
+	return count * sizeof(T);
+}
+
+/**
+ *  @brief  Header for a tree of n elements, without the checksum.
+ */
+template <typename T, typename Op, typename Layout>
+FileHeader make_header(int n)
+{
+	FileHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, "SEGTREE", 8);
+	header.version = FileHeader::current_version;
+	header.endianness = FileHeader::byte_order_mark;
+	header.value_size = sizeof(T);
+	header.value_kind = value_kind<T>();
+	header.layout = FormatId<Layout>::value;
+	header.operation = FormatId<Op>::value;
+	header.n = n;
+	header.node_count = Layout::node_count(n);
+	return header;
+}
+
+/**
+ *  @brief  Checks that a header in the byte order of this machine describes a tree of T, Op and Layout.
+ *  @return	nullptr if it does, otherwise what does not match.
+ */
+template <typename T, typename Op, typename Layout>
+const char *check_header(const FileHeader &header)
+{
+	if (std::memcmp(header.magic, "SEGTREE", 8) != 0)
+		return "not a segment tree file";
+	if (header.version == 0 || header.version > FileHeader::current_version)
+		return "unsupported format version";
+	if (header.endianness != FileHeader::byte_order_mark)
+		return "saved with another byte order";
+	if (header.value_size != sizeof(T) || header.value_kind != value_kind<T>())
+		return "saved with another element type";
+	if (header.layout != FormatId<Layout>::value)
+		return "saved with another layout";
+	if (header.operation != FormatId<Op>::value)
+		return "saved with another operation";
+	if (header.n > std::uint64_t(std::numeric_limits<int>::max() / 4) || header.node_count != std::uint64_t(Layout::node_count(int(header.n))))
+		return "inconsistent number of elements and nodes";
+	return nullptr;
+}
+} // namespace detail
+} // namespace st
+#endif // SEGMENT_TREE_FILE_FORMAT_H
@@ -0,0 +1,245 @@
+#ifndef SEGMENT_TREE_GROWABLE_SEGMENT_TREE_H
+#define SEGMENT_TREE_GROWABLE_SEGMENT_TREE_H
+#include "iterator.h"
+#include "operations.h"
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <vector>
+namespace st
+{
+/*
+CLASS SUMMARY
+
+	template <typename T, typename Op = Sum<T>>
+	class GrowableSegmentTree;
+
+	// Constructors.
+	GrowableSegmentTree();
+	GrowableSegmentTree(const T *input, int n);
+	GrowableSegmentTree(_InputIterator first, _InputIterator last);
+
+	// Iterators.
+	const_iterator begin() const;
+	const_iterator end() const;
+
+	// Capacity
+	bool empty() const;
+	int size() const;
+	int capacity() const;
+	void reserve(int n);
+	std::size_t memory_footprint() const;
+
+	// Modifiers.
+	void push_back(const T &val);
+	void append(_InputIterator first, _InputIterator last);
+
+	// Specialized algorithms.
+	T sum(int queryLeft, int queryRight) const;
+	void update(int index, T newVal);
+*/
+
+/**
+ *  @brief  Segment tree whose elements can be appended at the end.
+ *
+ *  Nodes follow BottomUpLayout over a power of two capacity instead of the size: leaf i is
+ *  at capacity + i, the parent of i is at i / 2, and leaves past the size hold
+ *  Op::identity(). Appending writes leaves that already have their place in the tree, so
+ *  push_back() only recomputes one path and append() only the ancestors of the new leaves.
+ *
+ *  When the capacity runs out it doubles. The old tree becomes the left half of the new
+ *  one, copied level by level, the new right half holds identities only, and just the
+ *  spine above the old root is recomputed. Doubling costs O(capacity), so a push_back takes
+ *  O(logN) amortized time.
+ */
+template <typename T, typename Op = Sum<T>>
+class GrowableSegmentTree
+{
+public:
+	typedef Iterator<const T> const_iterator;
+
+private:
+	// Underlying data structure for the segment tree, 2 * capacity_ nodes.
+	std::vector<T> tree_;
+	int n_;
+	// Number of leaves, a power of two or 0.
+	int capacity_;
+
+public:
+	// Constructors.
+
+	/**
+	 *  @brief  Creates a Segment Tree with no elements.
+	 */
+	explicit GrowableSegmentTree() : n_(0), capacity_(0) {}
+
+	/**
+	 *  @brief  Creates a segment tree from an input array.
+	 *  @param  input	Input array whose elements are used to build the segment tree.
+	 *  @param  n	Number of elements of input array to use.
+	 *
+	 *  This is linear in N.
+	 */
+	GrowableSegmentTree(const T *input, int n) : n_(0), capacity_(0)
+	{
+		append(input, input + n);
+	}
+
+	/**
+	 *  @brief  Builds a segment tree from a range.
+	 *  @param  first	An input iterator.
+	 *  @param  last	An input iterator.
+	 *
+	 *  This is linear in N.
+	 */
+	template <typename _InputIterator>
+	GrowableSegmentTree(_InputIterator first, _InputIterator last) : n_(0), capacity_(0)
+	{
+		append(first, last);
+	}
+
+	///  Returns a read-only iterator referring to the first element in the container.
+	const_iterator begin() const { return const_iterator(tree_.data() + capacity_); }
+
+	///  Returns a read-only iterator that points one past the last element in the container.
+	const_iterator end() const { return const_iterator(tree_.data() + capacity_ + n_); }
+
+	///  Returns true if the SegmentTree is empty.
+	bool empty() const { return n_ == 0; }
+
+	///  Returns the size of the SegmentTree.
+	int size() const { return n_; }
+
+	///  Returns the number of elements the tree holds before it has to grow.
+	int capacity() const { return capacity_; }
+
+	///  Returns the number of bytes used by the nodes.
+	std::size_t memory_footprint() const { return tree_.size() * sizeof(T); }
+
+	/**
+	 *  @brief  Grows the capacity to at least n elements.
+	 *
+	 *  Takes O(capacity) time if the tree grows.
+	 */
+	void reserve(int n)
+	{
+		if (n <= capacity_)
+			return;
+		int capacity = std::max(capacity_, 1);
+		while (capacity < n)
+		{
+			capacity *= 2;
+		}
+		grow(capacity);
+	}
+
+	/**
+	 *  @brief  Adds an element at the end.
+	 *  @param  val	The new element, at index size() - 1 once added.
+	 *
+	 *  Takes O(logN) amortized time.
+	 */
+	void push_back(const T &val)
+	{
+		if (n_ == capacity_)
+			reserve(n_ + 1);
+		++n_;
+		update(n_ - 1, val);
+	}
+
+	/**
+	 *  @brief  Adds the elements of a range at the end.
+	 *  @param  first	A forward iterator.
+	 *  @param  last	A forward iterator.
+	 *
+	 *  The new leaves are written first and then each of their ancestors is recomputed
+	 *  once, level by level. Takes O(K + logN) amortized time for K elements.
+	 */
+	template <typename _InputIterator>
+	void append(_InputIterator first, _InputIterator last)
+	{
+		int count = std::distance(first, last);
+		if (count <= 0)
+			return;
+		reserve(n_ + count);
+		std::copy(first, last, tree_.begin() + capacity_ + n_);
+		int left = capacity_ + n_, right = capacity_ + n_ + count - 1;
+		n_ += count;
+		for (left /= 2, right /= 2; left > 0; left /= 2, right /= 2)
+		{
+			for (int i = left; i <= right; ++i)
+			{
+				tree_[i] = Op::combine(tree_[2 * i], tree_[2 * i + 1]);
+			}
+		}
+	}
+
+	/**
+	 *  @brief	Finds sum of consecutive elements in a range [queryLeft,queryRight).
+	 *  @param	queryLeft	Left index of range for which sum has to be found.
+	 *  @param	queryRight	Right index of range (Non-inclusive) for which sum has to be found.
+	 *  @return	Sum of range of consecutive elements from [queryLeft, queryRight)
+	 *
+	 *  Takes O(logN) time.
+	 */
+	T sum(int queryLeft, int queryRight) const
+	{
+		queryLeft = std::max(queryLeft, 0);
+		queryRight = std::min(queryRight, n_);
+		T resultLeft = Op::identity(), resultRight = Op::identity();
+		for (queryLeft += capacity_, queryRight += capacity_; queryLeft < queryRight; queryLeft >>= 1, queryRight >>= 1)
+		{
+			if (queryLeft & 1)
+				resultLeft = Op::combine(resultLeft, tree_[queryLeft++]);
+			if (queryRight & 1)
+				resultRight = Op::combine(tree_[--queryRight], resultRight);
+		}
+		return Op::combine(resultLeft, resultRight);
+	}
+
+	/**
+	 *  @brief 	Modify a specific element in the tree.
+	 *  @param  index	Index of element to be updated.
+	 *  @param  newVal	New value of the element.
+	 *
+	 *  Takes O(logN) time.
+	 */
+	void update(int index, T newVal)
+	{
+		if (index < 0 || index >= n_)
+			return;
+		int i = capacity_ + index;
+		tree_[i] = newVal;
+		for (i /= 2; i > 0; i /= 2)
+		{
+			tree_[i] = Op::combine(tree_[2 * i], tree_[2 * i + 1]);
+		}
+	}
+
+private:
+	/**
+	 *  @brief  Moves the nodes to a tree of a larger power of two capacity.
+	 *
+	 *  The old tree becomes the leftmost subtree of the new one: the level starting at node
+	 *  2^d moves to the level starting at 2^(d+k), where capacity = capacity_ * 2^k. The nodes
+	 *  on the left spine above it are the only ones left to compute, as everything to their
+	 *  right is identity.
+	 */
+	void grow(int capacity)
+	{
+		std::vector<T> tree(2 * capacity, Op::identity());
+		int shift = capacity_ > 0 ? capacity / capacity_ : 0;
+		for (int level = 1; level < 2 * capacity_; level *= 2)
+		{
+			std::move(tree_.begin() + level, tree_.begin() + 2 * level, tree.begin() + level * shift);
+		}
+		for (int i = shift / 2; i > 0; i /= 2)
+		{
+			tree[i] = Op::combine(tree[2 * i], tree[2 * i + 1]);
+		}
+		tree_.swap(tree);
+		capacity_ = capacity;
+	}
+};
+} // namespace st
+#endif // SEGMENT_TREE_GROWABLE_SEGMENT_TREE_H
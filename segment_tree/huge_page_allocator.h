@@ -0,0 +1,132 @@
+#ifndef SEGMENT_TREE_HUGE_PAGE_ALLOCATOR_H
+#define SEGMENT_TREE_HUGE_PAGE_ALLOCATOR_H
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+namespace st
+{
+/*
+CLASS SUMMARY
+
+	template <typename T>
+	class HugePageAllocator;
+
+	Allocator for the Alloc parameter of SegmentTree, for trees large enough to suffer from
+	TLB misses:
+
+	SegmentTree<int, Sum<int>, BottomUpLayout, HugePageAllocator<int>> tree(input, n);
+
+	Arrays of at least huge_page_size bytes are mapped on their own, rounded up to whole
+	huge pages and aligned to huge_page_size. On Linux explicit huge pages (MAP_HUGETLB)
+	are tried first; if none are reserved the mapping falls back to normal pages marked
+	with madvise(MADV_HUGEPAGE) so that transparent huge pages back it when enabled.
+	Smaller arrays and other systems get memory aligned to cache_line_size.
+*/
+template <typename T>
+class HugePageAllocator
+{
+public:
+	typedef T value_type;
+	typedef std::true_type is_always_equal;
+
+	/// Alignment of every array.
+	static constexpr std::size_t cache_line_size = 64;
+
+	/// Size of a huge page, and the size from which arrays are mapped on their own.
+	static constexpr std::size_t huge_page_size = std::size_t(2) << 20;
+
+	HugePageAllocator() noexcept {}
+
+	template <typename U>
+	HugePageAllocator(const HugePageAllocator<U> &) noexcept {}
+
+	/**
+	 *  @brief  Allocates an array of count T.
+	 *  @throw  std::bad_array_new_length if count * sizeof(T) does not fit in a size_t.
+	 *  @throw  std::bad_alloc if no memory is available.
+	 */
+	T *allocate(std::size_t count)
+	{
+		if (count > std::size_t(-1) / sizeof(T))
+			throw std::bad_array_new_length();
+		std::size_t bytes = count * sizeof(T);
+#if defined(__linux__)
+		if (bytes >= huge_page_size)
+			return static_cast<T *>(map(round_up(bytes)));
+#endif
+		return static_cast<T *>(::operator new(bytes, std::align_val_t(cache_line_size)));
+	}
+
+	/**
+	 *  @brief  Frees an array returned by allocate(count).
+	 */
+	void deallocate(T *first, std::size_t count) noexcept
+	{
+		std::size_t bytes = count * sizeof(T);
+#if defined(__linux__)
+		if (bytes >= huge_page_size)
+		{
+			munmap(first, round_up(bytes));
+			return;
+		}
+#endif
+		::operator delete(first, std::align_val_t(cache_line_size));
+	}
+
+	/**
+	 *  @brief  True if arrays of count T are mapped on their own, aligned to huge_page_size.
+	 */
+	static bool uses_huge_pages(std::size_t count)
+	{
+#if defined(__linux__)
+		return count * sizeof(T) >= huge_page_size;
+#else
+		return false;
+#endif
+	}
+
+	template <typename U>
+	bool operator==(const HugePageAllocator<U> &) const noexcept { return true; }
+
+	template <typename U>
+	bool operator!=(const HugePageAllocator<U> &) const noexcept { return false; }
+
+private:
+	/**
+	 *  @brief  Rounds bytes up to a multiple of huge_page_size.
+	 */
+	static std::size_t round_up(std::size_t bytes) { return (bytes + huge_page_size - 1) / huge_page_size * huge_page_size; }
+
+#if defined(__linux__)
+	/**
+	 *  @brief  Maps bytes, a multiple of huge_page_size, aligned to huge_page_size.
+	 */
+	static void *map(std::size_t bytes)
+	{
+		void *mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (mapped != MAP_FAILED)
+			return mapped;
+
+		// No explicit huge pages: over-map by one huge page and trim to an aligned range, so
+		// that transparent huge pages can back every part of it.
+		mapped = mmap(nullptr, bytes + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mapped == MAP_FAILED)
+			throw std::bad_alloc();
+		std::uintptr_t start = reinterpret_cast<std::uintptr_t>(mapped);
+		std::uintptr_t aligned = (start + huge_page_size - 1) / huge_page_size * huge_page_size;
+		if (aligned > start)
+			munmap(mapped, aligned - start);
+		munmap(reinterpret_cast<void *>(aligned + bytes), start + huge_page_size - aligned);
+#if defined(MADV_HUGEPAGE)
+		madvise(reinterpret_cast<void *>(aligned), bytes, MADV_HUGEPAGE);
+#endif
+		return reinterpret_cast<void *>(aligned);
+	}
+#endif
+};
+} // namespace st
+#endif // SEGMENT_TREE_HUGE_PAGE_ALLOCATOR_H
@@ -1,3 +1,5 @@
+#ifndef SEGMENT_TREE_ITERATOR_H
+#define SEGMENT_TREE_ITERATOR_H
 namespace st
 {
 template <typename T>
@@ -103,4 +105,5 @@ public:
 private:
     T *p_it_;
 };
-} // namespace st
\ No newline at end of file
+} // namespace st
+#endif // SEGMENT_TREE_ITERATOR_H
@@ -0,0 +1,808 @@
+#ifndef SEGMENT_TREE_LAYOUT_H
+#define SEGMENT_TREE_LAYOUT_H
+#include "operations.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+namespace st
+{
+/*
+LAYOUT SUMMARY
+
+	A layout decides how the nodes of a segment tree are placed in the node array
+	and provides the algorithms that walk that placement. Every layout exposes
+
+	static constexpr bool stores_leaves;
+	static int node_count(int n);
+	static int leaf_offset(int n);	// Only when stores_leaves.
+	template <typename Op, typename T> static void build(T *tree, const T *cont, int n);
+	template <typename Op, typename T> static void build_parallel(T *tree, const T *cont, int n, int threads);
+	template <typename Op, typename T> static T sum(const T *tree, int n, int queryLeft, int queryRight);
+	template <typename Op, typename T> static void update(T *tree, int n, int index, const T &newVal);
+	template <typename Op, typename T> static void sum_batch(const T *tree, int n, const std::pair<int, int> *ranges,
+															 const int *queries, int count, T *out);
+	template <typename Op, typename T> static void update_batch(T *tree, int n, const std::pair<int, T> *updates,
+																const int *valid, int count);
+
+	Op is the operation used to combine nodes (see operations.h).
+
+	sum() and update() may assume n > 0, 0 <= queryLeft < queryRight <= n and 0 <= index < n.
+	sum_batch() answers the ranges ranges[queries[i]] into out[queries[i]] for i < count, with
+	the same assumptions on every range.
+	build_parallel() builds the same nodes as build() using up to threads threads.
+	update_batch() applies the updates updates[valid[i]] for i < count, in that order, and
+	recomputes every ancestor of the updated elements once.
+
+	RecursiveLayout	- Children of vertice v at 2*v+1 and 2*v+2, walked top-down recursively. 4*n nodes.
+	BottomUpLayout	- Leaves at offset n, parent of i at i/2, walked bottom-up iteratively. 2*n nodes
+			  holding the elements themselves, so no separate element array is needed.
+	BlockedLayout<B>	- B-ary tree stored level by level from the leaves up, every node being B
+			  consecutive child aggregates. With B * sizeof(T) == 64 a node is one cache line.
+
+	When stores_leaves is true the elements live at tree + leaf_offset(n) and build() is
+	called with cont pointing there.
+*/
+
+namespace detail
+{
+/**
+ *  @brief  Answers a batch of ranges with one query of the layout each.
+ */
+template <typename Layout, typename Op, typename T>
+void sum_each(const T *tree, int n, const std::pair<int, int> *ranges, const int *queries, int count, T *out)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		const std::pair<int, int> &range = ranges[queries[i]];
+		out[queries[i]] = Layout::template sum<Op>(tree, n, range.first, range.second);
+	}
+}
+
+/**
+ *  @brief  Index of the highest set bit of a non-zero word.
+ */
+inline int highest_bit(std::uint64_t word)
+{
+#if defined(__GNUC__)
+	return 63 - __builtin_clzll(word);
+#else
+	int bit = 0;
+	while (word >>= 1)
+		++bit;
+	return bit;
+#endif
+}
+
+/**
+ *  @brief  Index of the lowest set bit of a non-zero word.
+ */
+inline int lowest_bit(std::uint64_t word)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(word);
+#else
+	int bit = 0;
+	while (!(word & 1))
+	{
+		word >>= 1;
+		++bit;
+	}
+	return bit;
+#endif
+}
+} // namespace detail
+
+/**
+ *  @brief  Top-down recursive layout rooted at vertice 0.
+ */
+struct RecursiveLayout
+{
+	/// Leaves are not contiguous, the tree keeps a separate element array.
+	static constexpr bool stores_leaves = false;
+
+	/**
+	 *  @brief  Number of nodes needed for n elements.
+	 *
+	 *  A segment tree has at max 4*n number of nodes, where n is the size of the input.
+	 */
+	static int node_count(int n) { return 4 * n; }
+
+	/**
+	 *  @brief  Build the segment tree from the elements in cont.
+	 *
+	 *  Takes O(N) time - linear in size of input.
+	 */
+	template <typename Op, typename T>
+	static void build(T *tree, const T *cont, int n)
+	{
+		if (n > 0)
+			build_util<Op>(tree, cont, 0, 0, n - 1);
+	}
+
+	/**
+	 *  @brief  Build the segment tree from the elements in cont using several threads.
+	 *
+	 *  The vertices at a fixed depth span disjoint ranges of near equal size, so their
+	 *  subtrees are built concurrently by build_util. The few vertices above them are then
+	 *  combined on the calling thread.
+	 *  Takes O(N / threads + threads) time.
+	 */
+	template <typename Op, typename T>
+	static void build_parallel(T *tree, const T *cont, int n, int threads)
+	{
+		int depth = 0;
+		while ((1 << depth) < 4 * threads && (n >> depth) >= 2 * detail::parallel_grain)
+		{
+			++depth;
+		}
+		if (depth == 0)
+		{
+			build<Op>(tree, cont, n);
+			return;
+		}
+		std::vector<Subtree> subtrees;
+		collect_util(subtrees, depth, 0, 0, n - 1);
+		detail::parallel_for(threads, 0, subtrees.size(), 1, [tree, cont, &subtrees](int first, int last) {
+			for (int i = first; i < last; ++i)
+			{
+				build_util<Op>(tree, cont, subtrees[i].vertice, subtrees[i].rangeLeft, subtrees[i].rangeRight);
+			}
+		});
+		combine_top_util<Op>(tree, depth, 0, 0, n - 1);
+	}
+
+	/**
+	 *  @brief  Finds sum of consecutive elements in a range [queryLeft,queryRight).
+	 *
+	 *  Takes O(logN) time.
+	 */
+	template <typename Op, typename T>
+	static T sum(const T *tree, int n, int queryLeft, int queryRight)
+	{
+		return sum_util<Op>(tree, queryLeft, queryRight - 1, 0, 0, n - 1);
+	}
+
+	/**
+	 *  @brief  Modify a specific element in the tree.
+	 *
+	 *  Takes O(logN) time.
+	 */
+	template <typename Op, typename T>
+	static void update(T *tree, int n, int index, const T &newVal)
+	{
+		update_util<Op>(tree, index, newVal, 0, 0, n - 1);
+	}
+
+	/**
+	 *  @brief  Finds the sums of a batch of ranges.
+	 *
+	 *  Each range is answered with walk(), the loop form of sum_util, so the batch pays
+	 *  no function call per visited vertice.
+	 */
+	template <typename Op, typename T>
+	static void sum_batch(const T *tree, int n, const std::pair<int, int> *ranges, const int *queries, int count, T *out)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			const std::pair<int, int> &range = ranges[queries[i]];
+			out[queries[i]] = walk<Op>(tree, n, range.first, range.second - 1);
+		}
+	}
+
+	/**
+	 *  @brief  Modify a batch of elements, recomputing each affected vertice once.
+	 *
+	 *  The updates are sorted by index and carried down the tree together, every vertice
+	 *  handing its children the part of the batch inside their range.
+	 *  Takes O(K log K) time for sorting plus O(distinct ancestors) vertices.
+	 */
+	template <typename Op, typename T>
+	static void update_batch(T *tree, int n, const std::pair<int, T> *updates, const int *valid, int count)
+	{
+		std::vector<int> order(valid, valid + count);
+		std::stable_sort(order.begin(), order.end(), [updates](int a, int b) { return updates[a].first < updates[b].first; });
+		if (count > 0)
+			update_batch_util<Op>(tree, updates, order.data(), 0, count, 0, 0, n - 1);
+	}
+
+private:
+	/**
+	 *  @brief  A vertice and the range it spans, built as one task by build_parallel.
+	 */
+	struct Subtree
+	{
+		int vertice, rangeLeft, rangeRight;
+	};
+
+	/**
+	 *  @brief  Util function to list the vertices depth levels below current vertice, left to right.
+	 */
+	static void collect_util(std::vector<Subtree> &subtrees, int depth, int currentVertice, int rangeLeft, int rangeRight)
+	{
+		if (depth == 0)
+		{
+			subtrees.push_back(Subtree{currentVertice, rangeLeft, rangeRight});
+			return;
+		}
+		int mid = rangeLeft + (rangeRight - rangeLeft) / 2;
+		collect_util(subtrees, depth - 1, currentVertice * 2 + 1, rangeLeft, mid);
+		collect_util(subtrees, depth - 1, currentVertice * 2 + 2, mid + 1, rangeRight);
+	}
+
+	/**
+	 *  @brief  Util function to combine the vertices above the subtrees listed by collect_util.
+	 */
+	template <typename Op, typename T>
+	static void combine_top_util(T *tree, int depth, int currentVertice, int rangeLeft, int rangeRight)
+	{
+		if (depth == 0)
+			return;
+		int mid = rangeLeft + (rangeRight - rangeLeft) / 2;
+		combine_top_util<Op>(tree, depth - 1, currentVertice * 2 + 1, rangeLeft, mid);
+		combine_top_util<Op>(tree, depth - 1, currentVertice * 2 + 2, mid + 1, rangeRight);
+		tree[currentVertice] = Op::combine(tree[currentVertice * 2 + 1], tree[currentVertice * 2 + 2]);
+	}
+
+	/**
+	 *  @brief	Build the segment tree.
+	 *  @param  currentVertice	Indice of current vertice in the segment tree.
+	 *  @param  rangeLeft	Left indice in the input array of range spanned by current vertice.
+	 *  @param  rangeRight	Right indice in the input array of range spanned by current vertice.
+	 *
+	 *  Takes O(N) time - linear in size of input.
+	 */
+	template <typename Op, typename T>
+	static void build_util(T *tree, const T *cont, int currentVertice, int rangeLeft, int rangeRight)
+	{
+		if (rangeLeft == rangeRight)
+		{
+			tree[currentVertice] = cont[rangeLeft];
+		}
+		else
+		{
+			int mid = rangeLeft + (rangeRight - rangeLeft) / 2;
+			build_util<Op>(tree, cont, currentVertice * 2 + 1, rangeLeft, mid);
+			build_util<Op>(tree, cont, currentVertice * 2 + 2, mid + 1, rangeRight);
+			tree[currentVertice] = Op::combine(tree[currentVertice * 2 + 1], tree[currentVertice * 2 + 2]);
+		}
+	}
+
+	/**
+	 *  @brief  Util function to find sum of consecutive elements in a range.
+	 *  @param  queryLeft	Left indice in the input array of query range.
+	 *  @param  queryRight	Right indice in the input array of query range (inclusive).
+	 *  @param  currentVertice	Indice of current vertice in the segment tree.
+	 *  @param  rangeLeft	Left indice in the input array of range spanned by current vertice.
+	 *  @param  rangeRight	Right indice in the input array of range spanned by current vertice.
+	 *  @return	Sum of range of consecutive elements from [queryLeft, queryRight]
+	 *
+	 *  Takes O(logN) time.
+	 */
+	template <typename Op, typename T>
+	static T sum_util(const T *tree, int queryLeft, int queryRight, int currentVertice, int rangeLeft, int rangeRight)
+	{
+		if (queryLeft > queryRight)
+			return Op::identity();
+		if (queryLeft == rangeLeft && queryRight == rangeRight)
+		{
+			return tree[currentVertice];
+		}
+		int mid = rangeLeft + (rangeRight - rangeLeft) / 2;
+
+		return Op::combine(sum_util<Op>(tree, queryLeft, std::min(queryRight, mid), currentVertice * 2 + 1, rangeLeft, mid),
+						   sum_util<Op>(tree, std::max(queryLeft, mid + 1), queryRight, currentVertice * 2 + 2, mid + 1, rangeRight));
+	}
+
+	/**
+	 *  @brief  Finds sum of consecutive elements in a range [queryLeft,queryRight] without recursion.
+	 *  @param  queryLeft	Left indice in the input array of query range.
+	 *  @param  queryRight	Right indice in the input array of query range (inclusive).
+	 *  @return	Sum of range of consecutive elements from [queryLeft, queryRight]
+	 *
+	 *  Descends to the vertice where the range splits between both children, then follows
+	 *  the left end of the range down the left child and the right end down the right child,
+	 *  picking up the vertices sum_util would return whole. Takes O(logN) time.
+	 */
+	template <typename Op, typename T>
+	static T walk(const T *tree, int n, int queryLeft, int queryRight)
+	{
+		int currentVertice = 0, rangeLeft = 0, rangeRight = n - 1, mid;
+		while (true)
+		{
+			if (queryLeft == rangeLeft && queryRight == rangeRight)
+				return tree[currentVertice];
+			mid = rangeLeft + (rangeRight - rangeLeft) / 2;
+			if (queryRight <= mid)
+			{
+				currentVertice = currentVertice * 2 + 1;
+				rangeRight = mid;
+			}
+			else if (queryLeft > mid)
+			{
+				currentVertice = currentVertice * 2 + 2;
+				rangeLeft = mid + 1;
+			}
+			else
+				break;
+		}
+
+		// Vertices right of the left end are found from the right, so they are prepended.
+		T resultLeft = Op::identity();
+		int vertice = currentVertice * 2 + 1, left = rangeLeft, right = mid;
+		while (queryLeft != left)
+		{
+			int childMid = left + (right - left) / 2;
+			if (queryLeft <= childMid)
+			{
+				resultLeft = Op::combine(tree[vertice * 2 + 2], resultLeft);
+				vertice = vertice * 2 + 1;
+				right = childMid;
+			}
+			else
+			{
+				vertice = vertice * 2 + 2;
+				left = childMid + 1;
+			}
+		}
+		resultLeft = Op::combine(tree[vertice], resultLeft);
+
+		T resultRight = Op::identity();
+		vertice = currentVertice * 2 + 2;
+		left = mid + 1;
+		right = rangeRight;
+		while (queryRight != right)
+		{
+			int childMid = left + (right - left) / 2;
+			if (queryRight > childMid)
+			{
+				resultRight = Op::combine(resultRight, tree[vertice * 2 + 1]);
+				vertice = vertice * 2 + 2;
+				left = childMid + 1;
+			}
+			else
+			{
+				vertice = vertice * 2 + 1;
+				right = childMid;
+			}
+		}
+		resultRight = Op::combine(resultRight, tree[vertice]);
+		return Op::combine(resultLeft, resultRight);
+	}
+
+	/**
+	 *  @brief  Util function to modify a batch of elements.
+	 *  @param  updates	Pairs of index and new value.
+	 *  @param  order	Indices into updates, sorted by index.
+	 *  @param  first	First entry of order inside the range spanned by current vertice.
+	 *  @param  last	One past the last such entry.
+	 *  @param  currentVertice	Indice of current vertice in the segment tree.
+	 *  @param  rangeLeft	Left indice in the input array of range spanned by current vertice.
+	 *  @param  rangeRight 	Right indice in the input array of range spanned by current vertice.
+	 */
+	template <typename Op, typename T>
+	static void update_batch_util(T *tree, const std::pair<int, T> *updates, const int *order, int first, int last,
+								  int currentVertice, int rangeLeft, int rangeRight)
+	{
+		if (rangeLeft == rangeRight)
+		{
+			// Several updates of one element keep the last one.
+			tree[currentVertice] = updates[order[last - 1]].second;
+			return;
+		}
+		int mid = rangeLeft + (rangeRight - rangeLeft) / 2;
+		int split = std::partition_point(order + first, order + last, [updates, mid](int update) { return updates[update].first <= mid; }) - order;
+		if (split > first)
+			update_batch_util<Op>(tree, updates, order, first, split, currentVertice * 2 + 1, rangeLeft, mid);
+		if (last > split)
+			update_batch_util<Op>(tree, updates, order, split, last, currentVertice * 2 + 2, mid + 1, rangeRight);
+		tree[currentVertice] = Op::combine(tree[currentVertice * 2 + 1], tree[currentVertice * 2 + 2]);
+	}
+
+	/**
+	 *  @brief  Util function to modify a specific element in the tree.
+	 *  @param  index	Index of element to be updated.
+	 *  @param  newVal	New value of the element.
+	 *  @param  currentVertice	Indice of current vertice in the segment tree.
+	 *  @param  rangeLeft	Left indice in the input array of range spanned by current vertice.
+	 *  @param  rangeRight 	Right indice in the input array of range spanned by current vertice.
+	 *
+	 *  Takes O(logN) time.
+	 */
+	template <typename Op, typename T>
+	static void update_util(T *tree, int index, const T &newVal, int currentVertice, int rangeLeft, int rangeRight)
+	{
+		if (rangeLeft == rangeRight)
+		{
+			tree[currentVertice] = newVal;
+		}
+		else
+		{
+			int mid = rangeLeft + (rangeRight - rangeLeft) / 2;
+			if (index <= mid)
+				update_util<Op>(tree, index, newVal, currentVertice * 2 + 1, rangeLeft, mid);
+			else
+				update_util<Op>(tree, index, newVal, currentVertice * 2 + 2, mid + 1, rangeRight);
+
+			tree[currentVertice] = Op::combine(tree[currentVertice * 2 + 1], tree[currentVertice * 2 + 2]);
+		}
+	}
+};
+
+/**
+ *  @brief  Iterative bottom-up layout.
+ *
+ *  Leaf i is stored at n + i and the parent of node i is i / 2, so node 1 is the root
+ *  and node 0 is unused. Queries and updates are plain loops over the leaf indices,
+ *  with no recursion and no midpoint computation per level.
+ */
+struct BottomUpLayout
+{
+	/// Leaves n .. 2n-1 are the elements in order.
+	static constexpr bool stores_leaves = true;
+
+	/**
+	 *  @brief  Number of nodes needed for n elements.
+	 */
+	static int node_count(int n) { return 2 * n; }
+
+	/**
+	 *  @brief  Index of the first leaf.
+	 */
+	static int leaf_offset(int n) { return n; }
+
+	/**
+	 *  @brief  Build the segment tree from the elements in cont.
+	 *
+	 *  Takes O(N) time - linear in size of input.
+	 */
+	template <typename Op, typename T>
+	static void build(T *tree, const T *cont, int n)
+	{
+		build_parallel<Op>(tree, cont, n, 1);
+	}
+
+	/**
+	 *  @brief  Build the segment tree from the elements in cont using several threads.
+	 *
+	 *  Nodes [(end + 1) / 2, end) only have children at end or above, so the nodes are
+	 *  built in bands of halving size and every band is split between the threads.
+	 *  Takes O(N / threads + log(N)) time.
+	 */
+	template <typename Op, typename T>
+	static void build_parallel(T *tree, const T *cont, int n, int threads)
+	{
+		if (cont != tree + n)
+		{
+			detail::parallel_for(threads, 0, n, detail::parallel_grain, [tree, cont, n](int first, int last) {
+				std::copy(cont + first, cont + last, tree + n + first);
+			});
+		}
+		for (int bandEnd = n; bandEnd > 1; bandEnd = (bandEnd + 1) / 2)
+		{
+			detail::parallel_for(threads, (bandEnd + 1) / 2, bandEnd, detail::parallel_grain, [tree](int first, int last) {
+				for (int i = last - 1; i >= first; --i)
+				{
+					tree[i] = Op::combine(tree[2 * i], tree[2 * i + 1]);
+				}
+			});
+		}
+	}
+
+	/**
+	 *  @brief  Finds sum of consecutive elements in a range [queryLeft,queryRight).
+	 *
+	 *  Left and right partial results are kept apart so elements are always combined in order.
+	 *  Takes O(logN) time.
+	 */
+	template <typename Op, typename T>
+	static T sum(const T *tree, int n, int queryLeft, int queryRight)
+	{
+		T resultLeft = Op::identity(), resultRight = Op::identity();
+		for (queryLeft += n, queryRight += n; queryLeft < queryRight; queryLeft >>= 1, queryRight >>= 1)
+		{
+			if (queryLeft & 1)
+				resultLeft = Op::combine(resultLeft, tree[queryLeft++]);
+			if (queryRight & 1)
+				resultRight = Op::combine(tree[--queryRight], resultRight);
+		}
+		return Op::combine(resultLeft, resultRight);
+	}
+
+	/**
+	 *  @brief  Modify a specific element in the tree.
+	 *
+	 *  Takes O(logN) time.
+	 */
+	template <typename Op, typename T>
+	static void update(T *tree, int n, int index, const T &newVal)
+	{
+		index += n;
+		tree[index] = newVal;
+		for (index >>= 1; index > 0; index >>= 1)
+		{
+			tree[index] = Op::combine(tree[2 * index], tree[2 * index + 1]);
+		}
+	}
+
+	/**
+	 *  @brief  Finds the sums of a batch of ranges.
+	 */
+	template <typename Op, typename T>
+	static void sum_batch(const T *tree, int n, const std::pair<int, int> *ranges, const int *queries, int count, T *out)
+	{
+		detail::sum_each<BottomUpLayout, Op>(tree, n, ranges, queries, count, out);
+	}
+
+	/**
+	 *  @brief  Modify a batch of elements, recomputing each affected node once per round.
+	 *
+	 *  All leaves are written first and their parents are sorted, highest node first, with
+	 *  duplicates dropped. Each round recomputes the nodes of the list in that order, then
+	 *  halves them into the list of their parents, which halving keeps sorted, so dropping
+	 *  duplicates is one pass. A child is always a higher node than its parent, so every
+	 *  node is recomputed after the children the batch touched, also when leaves sit at two
+	 *  depths and a node comes back one round later.
+	 *  Takes O(K logK + distinct ancestors) time, about O(K log(N/K)), and O(K) memory.
+	 */
+	template <typename Op, typename T>
+	static void update_batch(T *tree, int n, const std::pair<int, T> *updates, const int *valid, int count)
+	{
+		std::vector<int> nodes(count);
+		for (int i = 0; i < count; ++i)
+		{
+			int node = n + updates[valid[i]].first;
+			tree[node] = updates[valid[i]].second;
+			nodes[i] = node >> 1;
+		}
+		std::sort(nodes.begin(), nodes.end(), std::greater<int>());
+		nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+		while (!nodes.empty() && nodes.front() > 0)
+		{
+			int parents = 0;
+			for (int node : nodes)
+			{
+				if (node == 0)
+					break;
+				tree[node] = Op::combine(tree[2 * node], tree[2 * node + 1]);
+				int parent = node >> 1;
+				if (parents == 0 || nodes[parents - 1] != parent)
+					nodes[parents++] = parent;
+			}
+			nodes.resize(parents);
+		}
+	}
+};
+/**
+ *  @brief  Cache-line-blocked B-ary layout.
+ *
+ *  Level 0 holds the elements, padded with the identity to a multiple of B. Every following level
+ *  holds one aggregate per block of B entries of the level below, again padded to a multiple
+ *  of B, up to a top level of exactly B entries. Entry i of a level has its children at
+ *  entries i*B .. i*B+B-1 of the level below.
+ *
+ *  Since every level starts at a multiple of B, choosing B * sizeof(T) == 64 and a 64 byte
+ *  aligned node array makes each block exactly one cache line, so a query touches at most two
+ *  lines per level and about log_B(N) levels. Within a block the work is a loop over
+ *  contiguous entries which the compiler can vectorize.
+ */
+template <int B>
+struct BlockedLayout
+{
+	static_assert(B >= 2, "BlockedLayout needs a fan-out of at least 2");
+
+	/// Level 0 holds the elements in order.
+	static constexpr bool stores_leaves = true;
+
+	/// Number of children per node.
+	static constexpr int fanout = B;
+
+	/**
+	 *  @brief  Number of nodes needed for n elements, including padding.
+	 */
+	static int node_count(int n)
+	{
+		int count = 0;
+		for (int size = round_up(n); size > 0; size = next_level_size(size))
+		{
+			count += size;
+		}
+		return count;
+	}
+
+	/**
+	 *  @brief  Index of the first leaf.
+	 */
+	static int leaf_offset(int) { return 0; }
+
+	/**
+	 *  @brief  Build the segment tree from the elements in cont.
+	 *
+	 *  Takes O(N) time - linear in size of input.
+	 */
+	template <typename Op, typename T>
+	static void build(T *tree, const T *cont, int n)
+	{
+		build_parallel<Op>(tree, cont, n, 1);
+	}
+
+	/**
+	 *  @brief  Build the segment tree from the elements in cont using several threads.
+	 *
+	 *  Every level only reads the level below it, so the blocks of a level are split
+	 *  between the threads, one level at a time.
+	 *  Takes O(N / threads + log_B(N)) time.
+	 */
+	template <typename Op, typename T>
+	static void build_parallel(T *tree, const T *cont, int n, int threads)
+	{
+		if (cont != tree)
+		{
+			detail::parallel_for(threads, 0, n, detail::parallel_grain, [tree, cont](int first, int last) {
+				std::copy(cont + first, cont + last, tree + first);
+			});
+		}
+		int size = round_up(n);
+		for (int i = n; i < size; ++i)
+		{
+			tree[i] = Op::identity();
+		}
+		for (int offset = 0; size > B; size = next_level_size(size))
+		{
+			T *parent = tree + offset + size;
+			const T *level = tree + offset;
+			int blocks = size / B;
+			detail::parallel_for(threads, 0, blocks, detail::parallel_grain / B, [parent, level](int first, int last) {
+				for (int block = first; block < last; ++block)
+				{
+					parent[block] = combine_block<Op>(level + block * B);
+				}
+			});
+			for (int block = blocks; block < round_up(blocks); ++block)
+			{
+				parent[block] = Op::identity();
+			}
+			offset += size;
+		}
+	}
+
+	/**
+	 *  @brief  Finds sum of consecutive elements in a range [queryLeft,queryRight).
+	 *
+	 *  At every level the entries before the first and after the last whole block are
+	 *  added directly, and the whole blocks are left to the level above.
+	 *  Takes O(B * log_B(N)) time, touching O(log_B(N)) cache lines.
+	 */
+	template <typename Op, typename T>
+	static T sum(const T *tree, int n, int queryLeft, int queryRight)
+	{
+		T resultLeft = Op::identity(), resultRight = Op::identity();
+		const T *level = tree;
+		for (int size = round_up(n);; size = next_level_size(size))
+		{
+			int blockLeft = (queryLeft + B - 1) / B, blockRight = queryRight / B;
+			if (size == B || blockLeft >= blockRight)
+			{
+				for (int i = queryLeft; i < queryRight; ++i)
+				{
+					resultLeft = Op::combine(resultLeft, level[i]);
+				}
+				break;
+			}
+			for (int i = queryLeft; i < blockLeft * B; ++i)
+			{
+				resultLeft = Op::combine(resultLeft, level[i]);
+			}
+			T partialRight = Op::identity();
+			for (int i = blockRight * B; i < queryRight; ++i)
+			{
+				partialRight = Op::combine(partialRight, level[i]);
+			}
+			resultRight = Op::combine(partialRight, resultRight);
+			queryLeft = blockLeft;
+			queryRight = blockRight;
+			level += size;
+		}
+		return Op::combine(resultLeft, resultRight);
+	}
+
+	/**
+	 *  @brief  Modify a specific element in the tree.
+	 *
+	 *  Every ancestor is recomputed from its B children, one cache line per level.
+	 *  Takes O(B * log_B(N)) time.
+	 */
+	template <typename Op, typename T>
+	static void update(T *tree, int n, int index, const T &newVal)
+	{
+		tree[index] = newVal;
+		T *level = tree;
+		for (int size = round_up(n); size > B; size = next_level_size(size))
+		{
+			int block = index / B;
+			level[size + block] = combine_block<Op>(level + block * B);
+			index = block;
+			level += size;
+		}
+	}
+
+	/**
+	 *  @brief  Finds the sums of a batch of ranges.
+	 */
+	template <typename Op, typename T>
+	static void sum_batch(const T *tree, int n, const std::pair<int, int> *ranges, const int *queries, int count, T *out)
+	{
+		detail::sum_each<BlockedLayout, Op>(tree, n, ranges, queries, count, out);
+	}
+
+	/**
+	 *  @brief  Modify a batch of elements, recomputing each affected node once.
+	 *
+	 *  All elements are written first and their blocks are sorted with duplicates dropped.
+	 *  Every level then recomputes the parents of its listed blocks and divides the list by
+	 *  B into the blocks of the level above, which keeps it sorted, so dropping duplicates
+	 *  is one pass. Takes O(K logK + B * distinct ancestors) time and O(K) memory.
+	 */
+	template <typename Op, typename T>
+	static void update_batch(T *tree, int n, const std::pair<int, T> *updates, const int *valid, int count)
+	{
+		std::vector<int> blocks(count);
+		for (int i = 0; i < count; ++i)
+		{
+			tree[updates[valid[i]].first] = updates[valid[i]].second;
+			blocks[i] = updates[valid[i]].first / B;
+		}
+		std::sort(blocks.begin(), blocks.end());
+		blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+
+		T *level = tree;
+		for (int size = round_up(n); size > B && !blocks.empty(); size = next_level_size(size))
+		{
+			int parents = 0;
+			for (int block : blocks)
+			{
+				level[size + block] = combine_block<Op>(level + block * B);
+				if (parents == 0 || blocks[parents - 1] != block / B)
+					blocks[parents++] = block / B;
+			}
+			blocks.resize(parents);
+			level += size;
+		}
+	}
+
+private:
+	/**
+	 *  @brief  Rounds count up to a multiple of B.
+	 */
+	static int round_up(int count) { return (count + B - 1) / B * B; }
+
+	/**
+	 *  @brief  Size of the level above a level of the given (padded) size, 0 above the top level.
+	 */
+	static int next_level_size(int size) { return size > B ? round_up(size / B) : 0; }
+
+	/**
+	 *  @brief  Combines the B consecutive entries starting at first.
+	 */
+	template <typename Op, typename T>
+	static T combine_block(const T *first)
+	{
+		T result = first[0];
+		for (int i = 1; i < B; ++i)
+		{
+			result = Op::combine(result, first[i]);
+		}
+		return result;
+	}
+};
+
+/**
+ *  @brief  BlockedLayout whose nodes are exactly one 64 byte cache line of T,
+ *  a fan-out of 16 for int and float and 8 for long and double.
+ */
+template <typename T>
+using CacheLineLayout = BlockedLayout<(64 / sizeof(T) >= 2 ? 64 / sizeof(T) : 2)>;
+} // namespace st
+#endif // SEGMENT_TREE_LAYOUT_H
@@ -0,0 +1,520 @@
+#ifndef SEGMENT_TREE_LAZY_SEGMENT_TREE_H
+#define SEGMENT_TREE_LAZY_SEGMENT_TREE_H
+#include <algorithm>
+#include <vector>
+namespace st
+{
+/*
+CLASS SUMMARY
+
+	// Constructors / Destructors.
+	LazySegmentTree();
+	LazySegmentTree(const LazySegmentTree& x);
+	LazySegmentTree(const T *input, int n);
+	LazySegmentTree(_InputIterator first, _InputIterator last);
+	~LazySegmentTree();
+
+	// Copy operator.
+	LazySegmentTree& operator=(const LazySegmentTree& x);
+
+	// Iterators.
+	iterator begin();
+	iterator end();
+	reverse_iterator rbegin();
+	reverse_iterator rend();
+
+	// Operations - Standard algorithms.
+	int count(const T &val);
+	iterator find(const T val);
+
+	// Capacity
+	bool empty();
+	int size();
+
+	// Element access.
+	T at(int index);
+
+	// Specialized algorithms.
+	T sum(int queryLeft, int queryRight);
+	void update(int index, T newVal);
+	void range_add(int queryLeft, int queryRight, T delta);
+	void range_assign(int queryLeft, int queryRight, T value);
+*/
+
+/**
+ *  @brief  Segment tree of sums supporting range updates through lazy propagation.
+ *
+ *  A range update stops at the O(logN) vertices covering the range and leaves a pending
+ *  tag on them. Tags are pushed to the children only when a later query or update has to
+ *  go below a tagged vertice. Vertices follow RecursiveLayout, children of v at 2*v+1 and 2*v+2.
+ *
+ *  The elements are the leaves of the tree and are only read through the pending tags on
+ *  their path: at() and the iterators push the tags down the root-to-leaf path of the one
+ *  element read, in O(logN). An iterator holds the tree and an index, so one obtained
+ *  before a range update reads the values after it.
+ */
+template <typename T>
+class LazySegmentTree
+{
+public:
+	/**
+	 *  @brief  Iterator reading the elements through at(), Step apart.
+	 *
+	 *  Dereferencing takes O(logN) time and always gives the current value.
+	 */
+	template <int Step>
+	class ElementIterator
+	{
+	public:
+		explicit ElementIterator(LazySegmentTree *owner = nullptr, int index = 0) : owner_(owner), index_(index) {}
+		bool operator==(const ElementIterator &rhs) const { return owner_ == rhs.owner_ && index_ == rhs.index_; }
+		bool operator!=(const ElementIterator &rhs) const { return !(*this == rhs); }
+		ElementIterator operator+(const int x) { return ElementIterator(owner_, index_ + Step * x); }
+		ElementIterator operator-(const int x) { return ElementIterator(owner_, index_ - Step * x); }
+		T operator*() { return owner_->at(index_); }
+		ElementIterator &operator++()
+		{
+			index_ += Step;
+			return *this;
+		}
+		ElementIterator operator++(int)
+		{
+			ElementIterator temp(*this);
+			++*this;
+			return temp;
+		}
+		ElementIterator &operator--()
+		{
+			index_ -= Step;
+			return *this;
+		}
+		ElementIterator operator--(int)
+		{
+			ElementIterator temp(*this);
+			--*this;
+			return temp;
+		}
+
+	private:
+		LazySegmentTree *owner_;
+		int index_;
+	};
+
+	// Iterator-related typedefs.
+	typedef ElementIterator<1> iterator;
+	typedef ElementIterator<-1> reverse_iterator;
+
+private:
+	// Underlying data structure for the segment tree, the elements being its leaves.
+	T *tree_;
+	// Pending tags: an assignment (if hasAssign_) followed by an addition, per vertice.
+	T *add_;
+	T *assign_;
+	bool *hasAssign_;
+	int n_;
+
+public:
+	// Constructors/Destructors.
+
+	/**
+	 *  @brief  Creates a Segment Tree with no elements.
+	 */
+	explicit LazySegmentTree() : tree_(nullptr), add_(nullptr), assign_(nullptr), hasAssign_(nullptr), n_(0) {}
+
+	/**
+	 *  @brief  Copy constructor.
+	 */
+	LazySegmentTree(const LazySegmentTree &x) : LazySegmentTree()
+	{
+		copy_from(x);
+	}
+
+	/**
+	 *  LazySegmentTree assignment operator.
+	 *  @param  x  A LazySegmentTree with identical element types.
+	 */
+	LazySegmentTree &operator=(const LazySegmentTree &x)
+	{
+		if (this != &x)
+		{
+			release();
+			copy_from(x);
+		}
+		return *this;
+	}
+
+	/**
+	 *  @brief  Creates a segment tree from an input array.
+	 *  @param  input	Input array whose elements are used to build the segment tree.
+	 *  @param  n	Number of elements of input array to use.
+	 *
+	 *  This is linear in N.
+	 */
+	LazySegmentTree(const T *input, int n) : LazySegmentTree()
+	{
+		allocate(n);
+		if (n_ > 0)
+			build(input, 0, 0, n_ - 1);
+	}
+
+	/**
+	 *  @brief  Builds a segment tree from a range.
+	 *  @param  first	An input iterator.
+	 *  @param  last	An input iterator.
+	 *
+	 *  This is linear in N.
+	 */
+	template <typename _InputIterator>
+	LazySegmentTree(_InputIterator first, _InputIterator last) : LazySegmentTree()
+	{
+		std::vector<T> input(first, last);
+		allocate(input.size());
+		if (n_ > 0)
+			build(input.data(), 0, 0, n_ - 1);
+	}
+
+	/**
+	 *  @brief  Destructor for segment tree.
+	 */
+	~LazySegmentTree()
+	{
+		release();
+	}
+
+	/**
+	 *  Returns an iterator referring to the first element in the container.
+	 */
+	iterator begin() { return iterator(this, 0); }
+
+	/**
+	 * Returns an iterator that points one past the last element in the container.
+	 */
+	iterator end() { return iterator(this, n_); }
+
+	/**
+	 *  Returns a reverse iterator referring to the last element in the container.
+	 */
+	reverse_iterator rbegin() { return reverse_iterator(this, n_ - 1); }
+
+	/**
+	 *  Returns a reverse iterator referring to one past the first element in the container.
+	 */
+	reverse_iterator rend() { return reverse_iterator(this, -1); }
+
+	/**
+	 *  @brief	Finds the number of elements.
+	 *  @param	val	Element to located.
+	 *  @return	Number of elements with specified val.
+	 *
+	 *  Visits every leaf once, pushing the tags down on the way. Takes O(N) time.
+	 */
+	int count(const T &val)
+	{
+		int count = 0;
+		if (n_ > 0)
+			find_util(val, count, false, 0, 0, n_ - 1);
+		return count;
+	}
+
+	/**
+	 *  @brief  Finds the first element that matches val.
+	 *  @param  val  Element to located.
+	 *  @return Iterator to an element with val equivalent to val.
+	 *	If no such element is found, past-the-end iterator is returned.
+	 *
+	 *  Visits the leaves in order up to the first match. Takes O(N) time.
+	 */
+	iterator find(const T val)
+	{
+		int index = 0;
+		if (n_ > 0)
+			find_util(val, index, true, 0, 0, n_ - 1);
+		return begin() + index;
+	}
+
+	///  Returns true if the LazySegmentTree is empty.
+	bool empty() const { return n_ == 0; }
+
+	///  Returns the size of the LazySegmentTree.
+	int size() const { return n_; }
+
+	/**
+	 *  @brief  Returns the current value of an element.
+	 *  @param  index	Index of the element, in [0, size()).
+	 *
+	 *  Pushes the pending tags down the path from the root to the element only.
+	 *  Takes O(logN) time.
+	 */
+	T at(int index)
+	{
+		int currentVertice = 0, rangeLeft = 0, rangeRight = n_ - 1;
+		while (rangeLeft < rangeRight)
+		{
+			int mid = rangeLeft + (rangeRight - rangeLeft) / 2;
+			push(currentVertice, rangeLeft, mid, rangeRight);
+			if (index <= mid)
+			{
+				currentVertice = currentVertice * 2 + 1;
+				rangeRight = mid;
+			}
+			else
+			{
+				currentVertice = currentVertice * 2 + 2;
+				rangeLeft = mid + 1;
+			}
+		}
+		return tree_[currentVertice];
+	}
+
+	/**
+	 *  @brief	Finds sum of consecutive elements in a range [queryLeft,queryRight).
+	 *  @param	queryLeft	Left index of range for which sum has to be found.
+	 *  @param	queryRight	Right index of range (Non-inclusive) for which sum has to be found.
+	 *  @return	Sum of range of consecutive elements from [queryLeft, queryRight)
+	 *
+	 *  Takes O(logN) time.
+	 */
+	T sum(int queryLeft, int queryRight)
+	{
+		if (n_ > 0 && queryLeft < queryRight)
+			return sum_util(queryLeft, queryRight - 1, 0, 0, n_ - 1);
+		return T();
+	}
+
+	/**
+	 *  @brief 	Modify a specific element in the tree.
+	 *  @param  index	Index of element to be updated.
+	 *  @param  newVal	New value of the element.
+	 *
+	 *  Takes O(logN) time.
+	 */
+	void update(int index, T newVal)
+	{
+		if (index >= 0 && index < n_)
+			range_util(index, index, newVal, true, 0, 0, n_ - 1);
+	}
+
+	/**
+	 *  @brief 	Adds delta to every element in a range [queryLeft,queryRight).
+	 *  @param	queryLeft	Left index of the range.
+	 *  @param	queryRight	Right index of the range (Non-inclusive).
+	 *  @param  delta	Value added to each element.
+	 *
+	 *  Takes O(logN) time.
+	 */
+	void range_add(int queryLeft, int queryRight, T delta)
+	{
+		if (n_ > 0 && queryLeft < queryRight)
+			range_util(queryLeft, queryRight - 1, delta, false, 0, 0, n_ - 1);
+	}
+
+	/**
+	 *  @brief 	Sets every element in a range [queryLeft,queryRight) to value.
+	 *  @param	queryLeft	Left index of the range.
+	 *  @param	queryRight	Right index of the range (Non-inclusive).
+	 *  @param  value	New value of each element.
+	 *
+	 *  Takes O(logN) time.
+	 */
+	void range_assign(int queryLeft, int queryRight, T value)
+	{
+		if (n_ > 0 && queryLeft < queryRight)
+			range_util(queryLeft, queryRight - 1, value, true, 0, 0, n_ - 1);
+	}
+
+private:
+	/**
+	 *  @brief  Allocates storage for n elements with no pending tags.
+	 */
+	void allocate(int n)
+	{
+		n_ = n;
+		tree_ = new T[4 * n];
+		add_ = new T[4 * n]();
+		assign_ = new T[4 * n]();
+		hasAssign_ = new bool[4 * n]();
+	}
+
+	/**
+	 *  @brief  Frees the storage, leaving an empty tree.
+	 */
+	void release()
+	{
+		delete[] tree_;
+		delete[] add_;
+		delete[] assign_;
+		delete[] hasAssign_;
+		tree_ = nullptr;
+		add_ = nullptr;
+		assign_ = nullptr;
+		hasAssign_ = nullptr;
+		n_ = 0;
+	}
+
+	/**
+	 *  @brief  Copies the elements, the vertices and the pending tags of x.
+	 */
+	void copy_from(const LazySegmentTree &x)
+	{
+		allocate(x.n_);
+		std::copy(x.tree_, x.tree_ + 4 * n_, tree_);
+		std::copy(x.add_, x.add_ + 4 * n_, add_);
+		std::copy(x.assign_, x.assign_ + 4 * n_, assign_);
+		std::copy(x.hasAssign_, x.hasAssign_ + 4 * n_, hasAssign_);
+	}
+
+	/**
+	 *  @brief  Sets all elements spanned by a vertice to value.
+	 */
+	void apply_assign(int currentVertice, int length, const T &value)
+	{
+		tree_[currentVertice] = value * static_cast<T>(length);
+		assign_[currentVertice] = value;
+		hasAssign_[currentVertice] = true;
+		add_[currentVertice] = T();
+	}
+
+	/**
+	 *  @brief  Adds delta to all elements spanned by a vertice.
+	 */
+	void apply_add(int currentVertice, int length, const T &delta)
+	{
+		tree_[currentVertice] = tree_[currentVertice] + delta * static_cast<T>(length);
+		if (hasAssign_[currentVertice])
+			assign_[currentVertice] = assign_[currentVertice] + delta;
+		else
+			add_[currentVertice] = add_[currentVertice] + delta;
+	}
+
+	/**
+	 *  @brief  Moves the pending tags of a vertice to its children.
+	 */
+	void push(int currentVertice, int rangeLeft, int mid, int rangeRight)
+	{
+		int left = currentVertice * 2 + 1, right = currentVertice * 2 + 2;
+		if (hasAssign_[currentVertice])
+		{
+			apply_assign(left, mid - rangeLeft + 1, assign_[currentVertice]);
+			apply_assign(right, rangeRight - mid, assign_[currentVertice]);
+			hasAssign_[currentVertice] = false;
+		}
+		if (add_[currentVertice] != T())
+		{
+			apply_add(left, mid - rangeLeft + 1, add_[currentVertice]);
+			apply_add(right, rangeRight - mid, add_[currentVertice]);
+			add_[currentVertice] = T();
+		}
+	}
+
+	/**
+	 *  @brief	Build the segment tree.
+	 *  @param  input	Elements, which become the leaves.
+	 *  @param  currentVertice	Indice of current vertice in the segment tree.
+	 *  @param  rangeLeft	Left indice in the input array of range spanned by current vertice.
+	 *  @param  rangeRight	Right indice in the input array of range spanned by current vertice.
+	 *
+	 *  Takes O(N) time - linear in size of input.
+	 */
+	void build(const T *input, int currentVertice, int rangeLeft, int rangeRight)
+	{
+		if (rangeLeft == rangeRight)
+		{
+			tree_[currentVertice] = input[rangeLeft];
+		}
+		else
+		{
+			int mid = rangeLeft + (rangeRight - rangeLeft) / 2;
+			build(input, currentVertice * 2 + 1, rangeLeft, mid);
+			build(input, currentVertice * 2 + 2, mid + 1, rangeRight);
+			tree_[currentVertice] = tree_[currentVertice * 2 + 1] + tree_[currentVertice * 2 + 2];
+		}
+	}
+
+	/**
+	 *  @brief  Util function to find sum of consecutive elements in a range.
+	 *  @param  queryLeft	Left indice in the input array of query range.
+	 *  @param  queryRight	Right indice in the input array of query range (inclusive).
+	 *  @param  currentVertice	Indice of current vertice in the segment tree.
+	 *  @param  rangeLeft	Left indice in the input array of range spanned by current vertice.
+	 *  @param  rangeRight	Right indice in the input array of range spanned by current vertice.
+	 *  @return	Sum of range of consecutive elements from [queryLeft, queryRight]
+	 *
+	 *  Takes O(logN) time.
+	 */
+	T sum_util(int queryLeft, int queryRight, int currentVertice, int rangeLeft, int rangeRight)
+	{
+		if (queryLeft > queryRight)
+			return T();
+		if (queryLeft == rangeLeft && queryRight == rangeRight)
+		{
+			return tree_[currentVertice];
+		}
+		int mid = rangeLeft + (rangeRight - rangeLeft) / 2;
+		push(currentVertice, rangeLeft, mid, rangeRight);
+
+		return sum_util(queryLeft, std::min(queryRight, mid), currentVertice * 2 + 1, rangeLeft, mid) +
+			   sum_util(std::max(queryLeft, mid + 1), queryRight, currentVertice * 2 + 2, mid + 1, rangeRight);
+	}
+
+	/**
+	 *  @brief  Util function to add to or assign a range of consecutive elements.
+	 *  @param  queryLeft	Left indice in the input array of the range.
+	 *  @param  queryRight	Right indice in the input array of the range (inclusive).
+	 *  @param  value	Value added or assigned.
+	 *  @param  isAssign	Assign value if true, add it otherwise.
+	 *  @param  currentVertice	Indice of current vertice in the segment tree.
+	 *  @param  rangeLeft	Left indice in the input array of range spanned by current vertice.
+	 *  @param  rangeRight	Right indice in the input array of range spanned by current vertice.
+	 *
+	 *  Takes O(logN) time.
+	 */
+	void range_util(int queryLeft, int queryRight, const T &value, bool isAssign, int currentVertice, int rangeLeft, int rangeRight)
+	{
+		if (queryLeft > queryRight)
+			return;
+		if (queryLeft == rangeLeft && queryRight == rangeRight)
+		{
+			if (isAssign)
+				apply_assign(currentVertice, rangeRight - rangeLeft + 1, value);
+			else
+				apply_add(currentVertice, rangeRight - rangeLeft + 1, value);
+			return;
+		}
+		int mid = rangeLeft + (rangeRight - rangeLeft) / 2;
+		push(currentVertice, rangeLeft, mid, rangeRight);
+		range_util(queryLeft, std::min(queryRight, mid), value, isAssign, currentVertice * 2 + 1, rangeLeft, mid);
+		range_util(std::max(queryLeft, mid + 1), queryRight, value, isAssign, currentVertice * 2 + 2, mid + 1, rangeRight);
+		tree_[currentVertice] = tree_[currentVertice * 2 + 1] + tree_[currentVertice * 2 + 2];
+	}
+
+	/**
+	 *  @brief  Util function visiting the leaves in order, pushing the tags down on the way.
+	 *  @param  val	Element to located.
+	 *  @param  result	Number of matches, or with stopAtMatch the index of the first match.
+	 *  @param  stopAtMatch	Stop at the first match instead of counting all of them.
+	 *  @param  currentVertice	Indice of current vertice in the segment tree.
+	 *  @param  rangeLeft	Left indice in the input array of range spanned by current vertice.
+	 *  @param  rangeRight	Right indice in the input array of range spanned by current vertice.
+	 *  @return	true once a match is found with stopAtMatch.
+	 *
+	 *  Takes O(N) time.
+	 */
+	bool find_util(const T &val, int &result, bool stopAtMatch, int currentVertice, int rangeLeft, int rangeRight)
+	{
+		if (rangeLeft == rangeRight)
+		{
+			bool match = tree_[currentVertice] == val;
+			if (stopAtMatch)
+				result = match ? rangeLeft : rangeLeft + 1;
+			else if (match)
+				++result;
+			return stopAtMatch && match;
+		}
+		int mid = rangeLeft + (rangeRight - rangeLeft) / 2;
+		push(currentVertice, rangeLeft, mid, rangeRight);
+		return find_util(val, result, stopAtMatch, currentVertice * 2 + 1, rangeLeft, mid) ||
+			   find_util(val, result, stopAtMatch, currentVertice * 2 + 2, mid + 1, rangeRight);
+	}
+};
+} // namespace st
+#endif // SEGMENT_TREE_LAZY_SEGMENT_TREE_H
@@ -0,0 +1,268 @@
+#ifndef SEGMENT_TREE_MAPPED_SEGMENT_TREE_H
+#define SEGMENT_TREE_MAPPED_SEGMENT_TREE_H
+#include "file_format.h"
+#include "iterator.h"
+#include "layout.h"
+#include "operations.h"
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+namespace st
+{
+/*
+CLASS SUMMARY
+
+	template <typename T, typename Op = Sum<T>, typename Layout = RecursiveLayout>
+	class MappedSegmentTree;
+
+	A segment tree whose nodes are a file written by SegmentTree::save, mapped into memory.
+
+	// Constructors / Destructors.
+	MappedSegmentTree();
+	MappedSegmentTree(const std::string &path, bool writable = false);
+	MappedSegmentTree(MappedSegmentTree&& x) noexcept;
+	~MappedSegmentTree();
+
+	// Iterators.
+	const_iterator begin() const;
+	const_iterator end() const;
+
+	// Capacity
+	bool empty() const;
+	int size() const;
+	bool writable() const;
+
+	// Specialized algorithms.
+	T sum(int queryLeft, int queryRight) const;
+	void update(int index, T newVal);				// Only when writable.
+	bool verify() const;
+*/
+
+/**
+ *  @brief  Segment tree answering queries straight from a file saved by SegmentTree::save.
+ *
+ *  Opening only checks the header and maps the file, so queries start at once whatever the
+ *  size of the tree, and pages are read from disk as queries touch them. Processes mapping
+ *  the same file share its pages in the page cache.
+ *
+ *  A read-only tree maps the file PROT_READ. A writable tree maps it MAP_PRIVATE: update()
+ *  changes private copies of the touched pages, never the file.
+ */
+template <typename T, typename Op = Sum<T>, typename Layout = RecursiveLayout>
+class MappedSegmentTree
+{
+	static_assert(std::is_trivially_copyable<T>::value, "MappedSegmentTree needs a trivially copyable type");
+	static_assert(alignof(T) <= sizeof(FileHeader), "MappedSegmentTree needs T aligned to at most 64 bytes");
+
+public:
+	typedef Iterator<const T> const_iterator;
+
+private:
+	// The whole mapped file, header included.
+	void *map_;
+	std::size_t length_;
+	// Node and element arrays inside the mapping, as in SegmentTree.
+	T *tree_;
+	T *cont_;
+	int n_;
+	bool writable_;
+
+public:
+	// Constructors/Destructors.
+
+	/**
+	 *  @brief  Creates a Segment Tree with no elements and no file.
+	 */
+	explicit MappedSegmentTree() : map_(nullptr), length_(0), tree_(nullptr), cont_(nullptr), n_(0), writable_(false) {}
+
+	MappedSegmentTree(const MappedSegmentTree &) = delete;
+	MappedSegmentTree &operator=(const MappedSegmentTree &) = delete;
+
+	/**
+	 *  @brief  Maps a file saved by SegmentTree<T, Op, Layout>::save.
+	 *  @param  path	File to map.
+	 *  @param  writable	Allow update(), on a private copy of the mapping.
+	 *  @throw  std::runtime_error if the file cannot be mapped or was saved from another
+	 *  kind of tree, another byte order or is truncated.
+	 *
+	 *  Takes O(1) time; the checksum is only checked by verify().
+	 */
+	explicit MappedSegmentTree(const std::string &path, bool writable = false)
+		: map_(nullptr), length_(0), tree_(nullptr), cont_(nullptr), n_(0), writable_(writable)
+	{
+#if defined(__unix__) || defined(__APPLE__)
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			throw std::runtime_error("MappedSegmentTree: cannot open " + path);
+		struct stat status;
+		if (fstat(fd, &status) != 0 || std::size_t(status.st_size) < sizeof(FileHeader))
+		{
+			close(fd);
+			throw std::runtime_error("MappedSegmentTree: " + path + " is too short");
+		}
+		length_ = status.st_size;
+		map_ = mmap(nullptr, length_, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (map_ == MAP_FAILED)
+		{
+			map_ = nullptr;
+			throw std::runtime_error("MappedSegmentTree: cannot map " + path);
+		}
+
+		const FileHeader *header = static_cast<const FileHeader *>(map_);
+		const char *error = detail::check_header<T, Op, Layout>(*header);
+		if (!error && length_ != sizeof(FileHeader) + detail::payload_size<T, Layout>(header->n))
+			error = "truncated file";
+		if (error)
+		{
+			unmap();
+			throw std::runtime_error("MappedSegmentTree: " + path + ": " + error);
+		}
+		n_ = header->n;
+		tree_ = reinterpret_cast<T *>(static_cast<char *>(map_) + sizeof(FileHeader));
+		cont_ = Layout::stores_leaves ? nullptr : tree_ + Layout::node_count(n_);
+#else
+		throw std::runtime_error("MappedSegmentTree: memory mapping is not supported on this system");
+#endif
+	}
+
+	/**
+	 *  @brief  Move constructor, leaving x empty.
+	 */
+	MappedSegmentTree(MappedSegmentTree &&x) noexcept
+		: map_(x.map_), length_(x.length_), tree_(x.tree_), cont_(x.cont_), n_(x.n_), writable_(x.writable_)
+	{
+		x.map_ = nullptr;
+		x.length_ = 0;
+		x.tree_ = nullptr;
+		x.cont_ = nullptr;
+		x.n_ = 0;
+	}
+
+	/**
+	 *  MappedSegmentTree move assignment operator, unmapping the file of this tree.
+	 */
+	MappedSegmentTree &operator=(MappedSegmentTree &&x) noexcept
+	{
+		if (this != &x)
+		{
+			unmap();
+			std::swap(map_, x.map_);
+			std::swap(length_, x.length_);
+			std::swap(tree_, x.tree_);
+			std::swap(cont_, x.cont_);
+			std::swap(n_, x.n_);
+			writable_ = x.writable_;
+		}
+		return *this;
+	}
+
+	/**
+	 *  @brief  Destructor, unmapping the file. Updates are discarded.
+	 */
+	~MappedSegmentTree()
+	{
+		unmap();
+	}
+
+	///  Returns a read-only iterator referring to the first element in the container.
+	const_iterator begin() const { return const_iterator(leaves()); }
+
+	///  Returns a read-only iterator that points one past the last element in the container.
+	const_iterator end() const { return const_iterator(leaves() + n_); }
+
+	///  Returns true if the SegmentTree is empty.
+	bool empty() const { return n_ == 0; }
+
+	///  Returns the size of the SegmentTree.
+	int size() const { return n_; }
+
+	///  Returns true if update() may modify the tree.
+	bool writable() const { return writable_; }
+
+	/**
+	 *  @brief	Finds sum of consecutive elements in a range [queryLeft,queryRight).
+	 *  @param	queryLeft	Left index of range for which sum has to be found.
+	 *  @param	queryRight	Right index of range (Non-inclusive) for which sum has to be found.
+	 *  @return	Sum of range of consecutive elements from [queryLeft, queryRight)
+	 *
+	 *  Takes O(logN) time, plus reading the touched pages on first access.
+	 */
+	T sum(int queryLeft, int queryRight) const
+	{
+		if (n_ > 0 && queryLeft < queryRight)
+			return Layout::template sum<Op>(tree_, n_, queryLeft, queryRight);
+		return Op::identity();
+	}
+
+	/**
+	 *  @brief 	Modify a specific element in the tree.
+	 *  @param  index	Index of element to be updated.
+	 *  @param  newVal	New value of the element.
+	 *
+	 *  Ignored unless the tree was mapped writable. The file is left unchanged.
+	 *  Takes O(logN) time.
+	 */
+	void update(int index, T newVal)
+	{
+		if (writable_ && index >= 0 && index < n_)
+		{
+			if (cont_)
+				cont_[index] = newVal;
+			Layout::template update<Op>(tree_, n_, index, newVal);
+		}
+	}
+
+	/**
+	 *  @brief  Checks the mapped nodes against the checksum of the header.
+	 *  @return	false if the file was damaged, or if update() has changed the tree.
+	 *
+	 *  Reads the whole file, so it takes O(N) time.
+	 */
+	bool verify() const
+	{
+		if (!map_)
+			return true;
+		const FileHeader *header = static_cast<const FileHeader *>(map_);
+		return detail::payload_checksum<T, Layout>(tree_, cont_, n_) == header->checksum;
+	}
+
+private:
+	/**
+	 *  @brief  Unmaps the file, leaving the tree empty.
+	 */
+	void unmap()
+	{
+#if defined(__unix__) || defined(__APPLE__)
+		if (map_)
+			munmap(map_, length_);
+#endif
+		map_ = nullptr;
+		length_ = 0;
+		tree_ = nullptr;
+		cont_ = nullptr;
+		n_ = 0;
+	}
+
+	/**
+	 *  @brief  Returns a pointer to the first element, either in cont_ or in the leaves of tree_.
+	 */
+	const T *leaves() const
+	{
+		if constexpr (Layout::stores_leaves)
+			return tree_ + Layout::leaf_offset(n_);
+		else
+			return cont_;
+	}
+};
+} // namespace st
+#endif // SEGMENT_TREE_MAPPED_SEGMENT_TREE_H
@@ -0,0 +1,179 @@
+#ifndef SEGMENT_TREE_OPERATIONS_H
+#define SEGMENT_TREE_OPERATIONS_H
+#include <limits>
+#include <numeric>
+#include <type_traits>
+namespace st
+{
+/*
+OPERATIONS SUMMARY
+
+	An operation tells the segment tree how two aggregates are combined and what
+	the aggregate of an empty range is. It is a stateless type with
+
+	static constexpr T identity();
+	static constexpr T combine(const T &a, const T &b);
+
+	combine must be associative and identity() must satisfy
+	combine(identity(), a) == combine(a, identity()) == a.
+	Both are called directly, so they inline exactly like a hand-written operator.
+
+	An operation whose aggregates can be taken apart again also has
+
+	static constexpr T inverse(const T &a, const T &b);
+
+	with combine(inverse(a, b), b) == a, so the sum of a range is the sum of a prefix with
+	the sum of a shorter prefix taken out. is_invertible<Op> tells whether Op has it.
+	ExactInverse<T, Op> tells whether taking sums apart is also exact, which holds for
+	integral T only; FenwickTree needs it and StaticSegmentTree answers from prefix sums
+	with it.
+
+	Sum<T>		- a + b, identity T(), inverse a - b	(default)
+	Min<T>		- smaller of a and b, identity the largest T
+	Max<T>		- larger of a and b, identity the lowest T
+	BitAnd<T>	- a & b, identity ~T()
+	BitOr<T>	- a | b, identity T()
+	BitXor<T>	- a ^ b, identity T(), inverse a ^ b
+	Gcd<T>		- greatest common divisor, identity T()
+*/
+
+/**
+ *  @brief  Sum of the elements.
+ */
+template <typename T>
+struct Sum
+{
+	static constexpr T identity() { return T(); }
+	static constexpr T combine(const T &a, const T &b) { return a + b; }
+	static constexpr T inverse(const T &a, const T &b) { return a - b; }
+};
+
+/**
+ *  @brief  Minimum of the elements.
+ */
+template <typename T>
+struct Min
+{
+	static constexpr T identity()
+	{
+		return std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+	}
+	static constexpr T combine(const T &a, const T &b) { return b < a ? b : a; }
+};
+
+/**
+ *  @brief  Maximum of the elements.
+ */
+template <typename T>
+struct Max
+{
+	static constexpr T identity()
+	{
+		return std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest();
+	}
+	static constexpr T combine(const T &a, const T &b) { return a < b ? b : a; }
+};
+
+/**
+ *  @brief  Bitwise and of the elements.
+ */
+template <typename T>
+struct BitAnd
+{
+	static_assert(std::is_integral<T>::value, "BitAnd needs an integral type");
+	static constexpr T identity() { return static_cast<T>(~T()); }
+	static constexpr T combine(const T &a, const T &b) { return a & b; }
+};
+
+/**
+ *  @brief  Bitwise or of the elements.
+ */
+template <typename T>
+struct BitOr
+{
+	static_assert(std::is_integral<T>::value, "BitOr needs an integral type");
+	static constexpr T identity() { return T(); }
+	static constexpr T combine(const T &a, const T &b) { return a | b; }
+};
+
+/**
+ *  @brief  Bitwise xor of the elements.
+ */
+template <typename T>
+struct BitXor
+{
+	static_assert(std::is_integral<T>::value, "BitXor needs an integral type");
+	static constexpr T identity() { return T(); }
+	static constexpr T combine(const T &a, const T &b) { return a ^ b; }
+	static constexpr T inverse(const T &a, const T &b) { return a ^ b; }
+};
+
+/**
+ *  @brief  Greatest common divisor of the elements.
+ *
+ *  gcd(0, a) == a, so 0 is the identity.
+ */
+template <typename T>
+struct Gcd
+{
+	static_assert(std::is_integral<T>::value, "Gcd needs an integral type");
+	static constexpr T identity() { return T(); }
+	static constexpr T combine(const T &a, const T &b) { return std::gcd(a, b); }
+};
+
+/**
+ *  @brief  Tells whether Op has an inverse(), as Sum and BitXor do.
+ */
+template <typename Op, typename = void>
+struct is_invertible : std::false_type
+{
+};
+
+template <typename Op>
+struct is_invertible<Op, std::void_t<decltype(&Op::inverse)>> : std::true_type
+{
+};
+
+namespace detail
+{
+template <typename T, bool Signed = std::is_integral<T>::value && std::is_signed<T>::value>
+struct UnsignedOf
+{
+	typedef T type;
+};
+
+template <typename T>
+struct UnsignedOf<T, true>
+{
+	typedef std::make_unsigned_t<T> type;
+};
+} // namespace detail
+
+/**
+ *  @brief  Tells whether sums of T can be taken apart exactly with Op::inverse.
+ *
+ *  value is true for an invertible Op over an integral T. Floating point sums are not
+ *  exact: a range taken out of a larger prefix loses the low bits the prefix had no room
+ *  for, so value is false for them.
+ *
+ *  Partial sums are kept in type and combined with op. For Sum over a signed T that is the
+ *  unsigned type of T, whose wrap-around is defined, so a prefix or a node may overflow
+ *  and the ranges asked for still come out exact as long as they fit in T.
+ */
+template <typename T, typename Op>
+struct ExactInverse
+{
+	static constexpr bool value = is_invertible<Op>::value && std::is_integral<T>::value && !std::is_same<T, bool>::value;
+	typedef T type;
+	typedef Op op;
+};
+
+template <typename T>
+struct ExactInverse<T, Sum<T>>
+{
+	static constexpr bool value = std::is_integral<T>::value && !std::is_same<T, bool>::value;
+	typedef typename detail::UnsignedOf<T>::type type;
+	typedef Sum<type> op;
+};
+} // namespace st
+#endif // SEGMENT_TREE_OPERATIONS_H
@@ -0,0 +1,56 @@
+#ifndef SEGMENT_TREE_PARALLEL_H
+#define SEGMENT_TREE_PARALLEL_H
+#include <algorithm>
+#include <thread>
+#include <vector>
+namespace st
+{
+namespace detail
+{
+/**
+ *  @brief  Smallest number of nodes worth handing to one thread.
+ *
+ *  Below this, starting a thread costs more than the work it takes over.
+ */
+inline constexpr int parallel_grain = 1 << 14;
+
+/**
+ *  @brief  Smallest number of range queries worth handing to one thread.
+ */
+inline constexpr int parallel_query_grain = 1 << 10;
+
+/**
+ *  @brief  Calls function(chunkFirst, chunkLast) on disjoint chunks covering [first, last).
+ *  @param  threads	Largest number of threads to use, including the calling thread.
+ *  @param  grain	Smallest number of items in a chunk.
+ *
+ *  The chunks are contiguous and of near equal size, one per thread. The calling thread
+ *  runs the first chunk and returns once every chunk is done.
+ */
+template <typename Function>
+void parallel_for(int threads, int first, int last, int grain, Function function)
+{
+	int chunks = std::min(threads, (last - first) / grain);
+	if (chunks <= 1)
+	{
+		if (first < last)
+			function(first, last);
+		return;
+	}
+	std::vector<std::thread> workers;
+	workers.reserve(chunks - 1);
+	for (int chunk = 1; chunk < chunks; ++chunk)
+	{
+		int chunkFirst = first + (long long)(last - first) * chunk / chunks;
+		int chunkLast = first + (long long)(last - first) * (chunk + 1) / chunks;
+		workers.emplace_back(function, chunkFirst, chunkLast);
+	}
+	function(first, first + (int)((long long)(last - first) / chunks));
+	for (std::thread &worker : workers)
+	{
+		worker.join();
+	}
+}
+} // namespace detail
+} // namespace st
+#endif // SEGMENT_TREE_PARALLEL_H
@@ -0,0 +1,230 @@
+#ifndef SEGMENT_TREE_PERSISTENT_SEGMENT_TREE_H
+#define SEGMENT_TREE_PERSISTENT_SEGMENT_TREE_H
+#include "operations.h"
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+namespace st
+{
+/*
+CLASS SUMMARY
+
+	template <typename T, typename Op = Sum<T>>
+	class PersistentSegmentTree;
+
+	// Constructors.
+	PersistentSegmentTree();
+	PersistentSegmentTree(const T *input, int n);
+	PersistentSegmentTree(_InputIterator first, _InputIterator last);
+
+	// Capacity
+	bool empty() const;
+	int size() const;
+	int versions() const;
+	std::size_t memory_footprint() const;
+
+	// Specialized algorithms.
+	T sum(int queryLeft, int queryRight) const;					// Latest version.
+	T sum(int version, int queryLeft, int queryRight) const;
+	int update(int index, T newVal);							// Returns the new version.
+	int update(int version, int index, T newVal);
+*/
+
+/**
+ *  @brief  Segment tree keeping every version of its elements.
+ *
+ *  Vertices are nodes of a pool linked by index, each version being the index of its root.
+ *  An update copies only the O(logN) vertices on the path to the element and links the
+ *  copies to the unchanged children of the old version, so old versions stay valid and
+ *  each version costs O(logN) nodes instead of a full copy of the tree.
+ *  Version 0 holds the elements the tree was built from.
+ */
+template <typename T, typename Op = Sum<T>>
+class PersistentSegmentTree
+{
+private:
+	/**
+	 *  @brief  A vertice: the sum of its range and the nodes of its two halves.
+	 */
+	struct Node
+	{
+		T value;
+		int left, right;
+	};
+
+	// Underlying data structure for the segment tree.
+	std::vector<Node> nodes_;
+	// Root node of each version.
+	std::vector<int> roots_;
+	int n_;
+
+public:
+	// Constructors.
+
+	/**
+	 *  @brief  Creates a Segment Tree with no elements.
+	 */
+	explicit PersistentSegmentTree() : roots_(1, -1), n_(0) {}
+
+	/**
+	 *  @brief  Creates a segment tree from an input array.
+	 *  @param  input	Input array whose elements are used to build the segment tree.
+	 *  @param  n	Number of elements of input array to use.
+	 *
+	 *  This is linear in N and allocates 2*n - 1 nodes.
+	 */
+	PersistentSegmentTree(const T *input, int n) : n_(n)
+	{
+		nodes_.reserve(n > 0 ? 2 * n - 1 : 0);
+		roots_.push_back(n > 0 ? build_util(input, 0, n - 1) : -1);
+	}
+
+	/**
+	 *  @brief  Builds a segment tree from a range.
+	 *  @param  first	An input iterator.
+	 *  @param  last	An input iterator.
+	 *
+	 *  This is linear in N.
+	 */
+	template <typename _InputIterator>
+	PersistentSegmentTree(_InputIterator first, _InputIterator last) : PersistentSegmentTree(std::vector<T>(first, last).data(), last - first)
+	{
+	}
+
+	///  Returns true if the SegmentTree is empty.
+	bool empty() const { return n_ == 0; }
+
+	///  Returns the size of the SegmentTree.
+	int size() const { return n_; }
+
+	///  Returns the number of versions, the latest being versions() - 1.
+	int versions() const { return roots_.size(); }
+
+	///  Returns the number of bytes used by the nodes and roots of all versions.
+	std::size_t memory_footprint() const { return nodes_.size() * sizeof(Node) + roots_.size() * sizeof(int); }
+
+	/**
+	 *  @brief	Finds sum of consecutive elements of the latest version in a range [queryLeft,queryRight).
+	 */
+	T sum(int queryLeft, int queryRight) const
+	{
+		return sum(versions() - 1, queryLeft, queryRight);
+	}
+
+	/**
+	 *  @brief	Finds sum of consecutive elements of a version in a range [queryLeft,queryRight).
+	 *  @param	version	Version to query, between 0 and versions() - 1.
+	 *  @param	queryLeft	Left index of range for which sum has to be found.
+	 *  @param	queryRight	Right index of range (Non-inclusive) for which sum has to be found.
+	 *  @return	Sum of range of consecutive elements from [queryLeft, queryRight)
+	 *
+	 *  Takes O(logN) time for any version.
+	 */
+	T sum(int version, int queryLeft, int queryRight) const
+	{
+		if (n_ > 0 && queryLeft < queryRight && version >= 0 && version < versions())
+			return sum_util(roots_[version], queryLeft, queryRight - 1, 0, n_ - 1);
+		return Op::identity();
+	}
+
+	/**
+	 *  @brief 	Creates a version from the latest one with one element modified.
+	 *  @param  index	Index of element to be updated.
+	 *  @param  newVal	New value of the element.
+	 *  @return	The new version, versions() - 1.
+	 *
+	 *  Takes O(logN) time and O(logN) new nodes.
+	 */
+	int update(int index, T newVal)
+	{
+		return update(versions() - 1, index, newVal);
+	}
+
+	/**
+	 *  @brief 	Creates a version from any version with one element modified.
+	 *  @param  version	Version to start from.
+	 *  @param  index	Index of element to be updated.
+	 *  @param  newVal	New value of the element.
+	 *  @return	The new version, versions() - 1, or -1 if version or index is out of range.
+	 *
+	 *  Takes O(logN) time and O(logN) new nodes.
+	 */
+	int update(int version, int index, T newVal)
+	{
+		if (version < 0 || version >= versions() || index < 0 || index >= n_)
+			return -1;
+		roots_.push_back(update_util(roots_[version], index, newVal, 0, n_ - 1));
+		return versions() - 1;
+	}
+
+private:
+	/**
+	 *  @brief	Build the nodes of a range.
+	 *  @param  rangeLeft	Left indice in the input array of range spanned by the vertice.
+	 *  @param  rangeRight	Right indice in the input array of range spanned by the vertice.
+	 *  @return	The node of the vertice.
+	 */
+	int build_util(const T *input, int rangeLeft, int rangeRight)
+	{
+		if (rangeLeft == rangeRight)
+			return make_node(input[rangeLeft], -1, -1);
+		int mid = rangeLeft + (rangeRight - rangeLeft) / 2;
+		int left = build_util(input, rangeLeft, mid);
+		int right = build_util(input, mid + 1, rangeRight);
+		return make_node(Op::combine(nodes_[left].value, nodes_[right].value), left, right);
+	}
+
+	/**
+	 *  @brief  Util function to find sum of consecutive elements in a range.
+	 *  @param  node	Node of current vertice.
+	 *  @param  queryLeft	Left indice in the input array of query range.
+	 *  @param  queryRight	Right indice in the input array of query range (inclusive).
+	 *  @param  rangeLeft	Left indice in the input array of range spanned by current vertice.
+	 *  @param  rangeRight	Right indice in the input array of range spanned by current vertice.
+	 *
+	 *  Takes O(logN) time.
+	 */
+	T sum_util(int node, int queryLeft, int queryRight, int rangeLeft, int rangeRight) const
+	{
+		if (queryLeft > queryRight)
+			return Op::identity();
+		if (queryLeft == rangeLeft && queryRight == rangeRight)
+			return nodes_[node].value;
+		int mid = rangeLeft + (rangeRight - rangeLeft) / 2;
+		return Op::combine(sum_util(nodes_[node].left, queryLeft, std::min(queryRight, mid), rangeLeft, mid),
+						   sum_util(nodes_[node].right, std::max(queryLeft, mid + 1), queryRight, mid + 1, rangeRight));
+	}
+
+	/**
+	 *  @brief  Util function to copy the path to an element with the element modified.
+	 *  @param  node	Node of current vertice in the old version.
+	 *  @param  index	Index of element to be updated.
+	 *  @param  newVal	New value of the element.
+	 *  @return	The node of current vertice in the new version.
+	 *
+	 *  Takes O(logN) time.
+	 */
+	int update_util(int node, int index, const T &newVal, int rangeLeft, int rangeRight)
+	{
+		if (rangeLeft == rangeRight)
+			return make_node(newVal, -1, -1);
+		int mid = rangeLeft + (rangeRight - rangeLeft) / 2;
+		int left = nodes_[node].left, right = nodes_[node].right;
+		if (index <= mid)
+			left = update_util(left, index, newVal, rangeLeft, mid);
+		else
+			right = update_util(right, index, newVal, mid + 1, rangeRight);
+		return make_node(Op::combine(nodes_[left].value, nodes_[right].value), left, right);
+	}
+
+	/**
+	 *  @brief  Appends a node to the pool and returns its index.
+	 */
+	int make_node(const T &value, int left, int right)
+	{
+		nodes_.push_back(Node{value, left, right});
+		return nodes_.size() - 1;
+	}
+};
+} // namespace st
+#endif // SEGMENT_TREE_PERSISTENT_SEGMENT_TREE_H
@@ -1,59 +1,127 @@
+#ifndef SEGMENT_TREE_SEGMENT_TREE_H
+#define SEGMENT_TREE_SEGMENT_TREE_H
+#include "file_format.h"
 #include "iterator.h"
+#include "layout.h"
+#include "operations.h"
+#include "parallel.h"
+#include "thread_pool.h"
 #include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
 namespace st
 {
 /*
 CLASS SUMMARY
 
+	template <typename T, typename Op = Sum<T>, typename Layout = RecursiveLayout, typename Alloc = std::allocator<T>>
+	class SegmentTree;
+
+	Op is the operation combining elements and its identity (see operations.h). Sum<T> is the
+	default; Min, Max, BitAnd, BitOr, BitXor and Gcd are provided.
+	Layout selects the node placement and the engine used by build, sum and update
+	(see layout.h). RecursiveLayout is the default; BottomUpLayout is the iterative engine.
+	Alloc provides the element and node arrays; st::pmr::SegmentTree uses a
+	std::pmr::polymorphic_allocator, so a tree can be built in any std::pmr::memory_resource.
+
 	// Constructors / Destructors.
 	SegmentTree();
+	SegmentTree(const Alloc& alloc);
 	SegmentTree(const SegmentTree& x);
-	SegmentTree(const T *input, int n);
-	SegmentTree(_InputIterator first, _InputIterator last);
+	SegmentTree(SegmentTree&& x) noexcept;
+	SegmentTree(const T *input, int n, const Alloc& alloc = Alloc());
+	SegmentTree(_InputIterator first, _InputIterator last, const Alloc& alloc = Alloc());
+	SegmentTree(const T *input, int n, int threads, const Alloc& alloc = Alloc());
+	SegmentTree(_InputIterator first, _InputIterator last, int threads, const Alloc& alloc = Alloc());
 	~SegmentTree();
 
-	// Copy operator.
+	// Copy and move operators.
 	SegmentTree& operator=(const SegmentTree& x);
+	SegmentTree& operator=(SegmentTree&& x);	// noexcept when Alloc propagates or always compares equal.
+	void swap(SegmentTree& x) noexcept;
+	Alloc get_allocator() const;
 
 	// Iterators.
 	iterator begin();
 	iterator end();
 	reverse_iterator rbegin();
 	reverse_iterator rend();
+	const_iterator begin() const;
+	const_iterator end() const;
+	const_reverse_iterator rbegin() const;
+	const_reverse_iterator rend() const;
 
 	// Operations - Standard algorithms.
-	int count(const T &val);
+	int count(const T &val) const;
 	iterator find(const T val);
 	iterator lower_bound(const T &val);
 	iterator upper_bound(const T &val);
 	std::pair<iterator, iterator> equal_range(const T &val);
+	// Each also has a const overload returning const_iterator.
 
 	// Capacity 
-	bool empty();
-	int size();
+	bool empty() const;
+	int size() const;
+	std::size_t memory_footprint() const;
+	long use_count() const;
 
 	// Specialized algorithms.
-	T sum(int queryLeft, int queryRight);
+	T sum(int queryLeft, int queryRight) const;
 	void update(int index, T newVal);
-
-	// Util functions for the segment tree.
-	void build(int currentVertice, int rangeLeft, int rangeRight);
-	T sum_util(int queryLeft, int queryRight, int currentVertice, int rangeLeft, int rangeRight);
-	void update_util(int index, T newVal, int currentVertice, int rangeLeft, int rangeRight);
+	void sum_batch(const std::pair<int, int> *ranges, int count, T *out) const;
+	void parallel_sum_batch(const std::pair<int, int> *ranges, int count, T *out, int threads) const;
+	void parallel_sum_batch(const std::pair<int, int> *ranges, int count, T *out, ThreadPool &pool) const;
+	void update_batch(const std::pair<int, T> *updates, int count);
+
+	// Storage, for trivially copyable T. See file_format.h and MappedSegmentTree.
+	bool save(std::ostream &out) const;
+	bool save(const std::string &path) const;
+	bool load(std::istream &in);
+	bool load(const std::string &path);
+
+	Copies share their buffers until one of them is modified (copy-on-write), so copying
+	and assigning a tree is O(1) and update() or update_batch() on a shared tree first
+	copies the buffers in O(N), which invalidates the iterators taken from that tree.
+	Buffers are only shared between trees whose allocators compare equal; otherwise the
+	copy is made up front with the allocator of the copy.
+
+	Const members only read the nodes and elements and keep no internal state, so any number
+	of threads may call them on one tree at once, as long as no thread modifies it.
 */
-template <typename T>
+template <typename T, typename Op = Sum<T>, typename Layout = RecursiveLayout, typename Alloc = std::allocator<T>>
 class SegmentTree
 {
+	static_assert(std::is_same<typename std::allocator_traits<Alloc>::value_type, T>::value, "Alloc must allocate T");
+
 public:
 	// Iterator-related typedefs.
 	typedef Iterator<T> iterator;
 	typedef ReverseIterator<T> reverse_iterator;
+	typedef Iterator<const T> const_iterator;
+	typedef ReverseIterator<const T> const_reverse_iterator;
 
 private:
+	typedef std::allocator_traits<Alloc> AllocTraits;
+	typedef typename AllocTraits::template rebind_alloc<std::atomic<long>> RefsAlloc;
+	typedef std::allocator_traits<RefsAlloc> RefsTraits;
+
+	// Allocator of cont_, tree_ and refs_.
+	Alloc alloc_;
 	// Underlying data structure for the segment tree.
+	// cont_ is only allocated when the layout does not keep the leaves in tree_.
 	T *cont_;
 	T *tree_;
 	int n_;
+	// Number of trees sharing cont_ and tree_, nullptr when nothing is allocated.
+	std::atomic<long> *refs_;
 
 public:
 	// Constructors/Destructors.
@@ -61,86 +129,183 @@ public:
 	/**
 	 *  @brief  Creates a Segment Tree with no elements.
 	 */
-	explicit SegmentTree() : cont_(nullptr), tree_(nullptr), n_(0) {}
+	explicit SegmentTree() : alloc_(), cont_(nullptr), tree_(nullptr), n_(0), refs_(nullptr) {}
+
+	/**
+	 *  @brief  Creates a Segment Tree with no elements that will allocate with alloc.
+	 */
+	explicit SegmentTree(const Alloc &alloc) : alloc_(alloc), cont_(nullptr), tree_(nullptr), n_(0), refs_(nullptr) {}
 
 	/**
 	 *  @brief  Copy constructor.
+	 *
+	 *  The copy shares the buffers of x until either of them is modified.
+	 *  Takes O(1) time, or O(N) if the allocator of the copy differs from that of x.
 	 */
-	SegmentTree(const SegmentTree &x) : cont_(new T[x.n_]), tree_(new T[4 * x.n_]), n_(x.n_)
+	SegmentTree(const SegmentTree &x)
+		: alloc_(AllocTraits::select_on_container_copy_construction(x.alloc_)), cont_(nullptr), tree_(nullptr), n_(0), refs_(nullptr)
 	{
-		for (int i = 0; i < n_; i++)
-		{
-			cont_[i] = x.cont_[i];
-		}
-		for (int i = 0; i < 4 * n_; i++)
-		{
-			tree_[i] = x.tree_[i];
-		}
+		share(x);
 	}
 
 	/**
 	 *  SegmentTree assignment operator.
 	 *  @param  x  A SegmentTree with identical element types.
+	 *
+	 *  Releases the buffers of this tree and shares those of x until either is modified.
 	 */
 	SegmentTree &operator=(const SegmentTree &x)
 	{
-		cont_ = new T[x.n_];
-		tree_ = new T[4 * x.n_];
-		n_ = x.n_;
-
-		for (int i = 0; i < n_; i++)
+		if (this != &x)
 		{
-			cont_[i] = x.cont_[i];
+			release();
+			if constexpr (AllocTraits::propagate_on_container_copy_assignment::value)
+				alloc_ = x.alloc_;
+			share(x);
 		}
-		for (int i = 0; i < 4 * n_; i++)
+		return *this;
+	}
+
+	/**
+	 *  @brief  Move constructor.
+	 *
+	 *  Takes the buffers of x, leaving x empty. Nothing is allocated or copied.
+	 */
+	SegmentTree(SegmentTree &&x) noexcept : alloc_(x.alloc_), cont_(x.cont_), tree_(x.tree_), n_(x.n_), refs_(x.refs_)
+	{
+		x.cont_ = nullptr;
+		x.tree_ = nullptr;
+		x.n_ = 0;
+		x.refs_ = nullptr;
+	}
+
+	/**
+	 *  SegmentTree move assignment operator.
+	 *  @param  x  A SegmentTree with identical element types, left empty.
+	 *
+	 *  Releases the buffers of this tree and takes those of x. If the allocators differ and
+	 *  do not propagate, the buffers of x are shared or copied as by copy assignment instead.
+	 */
+	SegmentTree &operator=(SegmentTree &&x) noexcept(AllocTraits::propagate_on_container_move_assignment::value ||
+													 AllocTraits::is_always_equal::value)
+	{
+		if (this != &x)
 		{
-			tree_[i] = x.tree_[i];
+			release();
+			if constexpr (AllocTraits::propagate_on_container_move_assignment::value)
+				alloc_ = x.alloc_;
+			if (alloc_ == x.alloc_)
+			{
+				swap_buffers(x);
+			}
+			else
+			{
+				share(x);
+				x.release();
+			}
 		}
 		return *this;
 	}
 
+	/**
+	 *  @brief  Exchanges the buffers of this tree and x.
+	 *
+	 *  The allocators are exchanged too when Alloc propagates on swap; otherwise they
+	 *  must compare equal.
+	 */
+	void swap(SegmentTree &x) noexcept
+	{
+		if constexpr (AllocTraits::propagate_on_container_swap::value)
+			std::swap(alloc_, x.alloc_);
+		swap_buffers(x);
+	}
+
 	/**
 	 *  @brief  Creates a segment tree from an input array.
 	 *  @param  input	Input array whose elements are used to build the segment tree.
 	 *  @param  n	Number of elements of input array to use.
+	 *  @param  alloc	Allocator of the element and node arrays.
 	 * 
 	 *   Create a segment tree consisting of copies of the elements from 0 to n - 1.
 	 * 	 This is linear in N. 
-	 *   A segment tree has at max 4*n number of nodes, where n is the size of the input.
+	 *   The number of nodes allocated is given by the layout, at max 4*n for RecursiveLayout.
 	 */
-	SegmentTree(const T *input, int n) : cont_(new T[n]), tree_(new T[4 * n]), n_(n)
+	SegmentTree(const T *input, int n, const Alloc &alloc = Alloc()) : alloc_(alloc), cont_(nullptr), tree_(nullptr), n_(0), refs_(nullptr)
 	{
+		allocate(n);
+		T *elements = leaves();
 		for (int i = 0; i < n; ++i)
 		{
-			cont_[i] = input[i];
+			elements[i] = input[i];
 		}
-		if (n_ > 0)
-			build(0, 0, n_ - 1);
+		Layout::template build<Op>(tree_, elements, n_);
 	}
 
 	/**
 	 *  @brief  Builds a segment tree from a range.
 	 *  @param  first	An input iterator.
 	 *  @param  last	An input iterator.
+	 *  @param  alloc	Allocator of the element and node arrays.
 	 *
 	 *  Create a segment tree consisting of copies of the elements from [first,last).
 	 *  This is linear in N. 
 	 */
 	template <typename _InputIterator>
-	SegmentTree(_InputIterator first, _InputIterator last)
+	SegmentTree(_InputIterator first, _InputIterator last, const Alloc &alloc = Alloc())
+		: alloc_(alloc), cont_(nullptr), tree_(nullptr), n_(0), refs_(nullptr)
 	{
-		n_ = last - first;
-		cont_ = new T[n_];
-		tree_ = new T[4 * n_];
+		allocate(last - first);
+		T *elements = leaves();
 		int i = 0;
 		while (first != last)
 		{
-			cont_[i] = *first;
+			elements[i] = *first;
 			++first;
 			++i;
 		}
-		if (n_ > 0)
-			build(0, 0, n_ - 1);
+		Layout::template build<Op>(tree_, elements, n_);
+	}
+
+	/**
+	 *  @brief  Creates a segment tree from an input array using several threads.
+	 *  @param  input	Input array whose elements are used to build the segment tree.
+	 *  @param  n	Number of elements of input array to use.
+	 *  @param  threads	Largest number of threads to use, including the calling thread.
+	 *  @param  alloc	Allocator of the element and node arrays.
+	 *
+	 *  Disjoint parts of the tree are built concurrently and the result is identical to
+	 *  SegmentTree(input, n). Inputs too small to split are built on the calling thread.
+	 */
+	SegmentTree(const T *input, int n, int threads, const Alloc &alloc = Alloc())
+		: alloc_(alloc), cont_(nullptr), tree_(nullptr), n_(0), refs_(nullptr)
+	{
+		allocate(n);
+		T *elements = leaves();
+		detail::parallel_for(threads, 0, n, detail::parallel_grain, [input, elements](int chunkFirst, int chunkLast) {
+			std::copy(input + chunkFirst, input + chunkLast, elements + chunkFirst);
+		});
+		Layout::template build_parallel<Op>(tree_, elements, n_, threads);
+	}
+
+	/**
+	 *  @brief  Builds a segment tree from a range using several threads.
+	 *  @param  first	A random access iterator.
+	 *  @param  last	A random access iterator.
+	 *  @param  threads	Largest number of threads to use, including the calling thread.
+	 *  @param  alloc	Allocator of the element and node arrays.
+	 *
+	 *  The result is identical to SegmentTree(first, last).
+	 */
+	template <typename _InputIterator>
+	SegmentTree(_InputIterator first, _InputIterator last, int threads, const Alloc &alloc = Alloc())
+		: alloc_(alloc), cont_(nullptr), tree_(nullptr), n_(0), refs_(nullptr)
+	{
+		allocate(last - first);
+		T *elements = leaves();
+		detail::parallel_for(threads, 0, n_, detail::parallel_grain, [first, elements](int chunkFirst, int chunkLast) {
+			std::copy(first + chunkFirst, first + chunkLast, elements + chunkFirst);
+		});
+		Layout::template build_parallel<Op>(tree_, elements, n_, threads);
 	}
 
 	/**
@@ -148,39 +313,49 @@ public:
 	 */
 	~SegmentTree()
 	{
-		delete[] cont_;
-		delete[] tree_;
-		n_ = 0;
+		release();
 	}
 
 	/**
 	 *  Returns an iterator referring to the first element in the container.
 	 */
-	iterator begin() { return iterator(cont_); }
+	iterator begin() { return iterator(leaves()); }
 
 	/**
 	 * Returns an iterator that points one past the last element in the container. 
 	 */
-	iterator end() { return iterator(cont_ + n_); }
+	iterator end() { return iterator(leaves() + n_); }
 
 	/**
 	 *  Returns a reverse iterator referring to the last element in the container.
 	 */
-	reverse_iterator rbegin() { return reverse_iterator(cont_ + n_ - 1); }
+	reverse_iterator rbegin() { return reverse_iterator(leaves() + n_ - 1); }
 
 	/**
 	 *  Returns a reverse iterator referring to one past the first element in the container.
 	 */
-	reverse_iterator rend() { return reverse_iterator(cont_ - 1); }
+	reverse_iterator rend() { return reverse_iterator(leaves() - 1); }
+
+	///  Returns a read-only iterator referring to the first element in the container.
+	const_iterator begin() const { return const_iterator(leaves()); }
+
+	///  Returns a read-only iterator that points one past the last element in the container.
+	const_iterator end() const { return const_iterator(leaves() + n_); }
+
+	///  Returns a read-only reverse iterator referring to the last element in the container.
+	const_reverse_iterator rbegin() const { return const_reverse_iterator(leaves() + n_ - 1); }
+
+	///  Returns a read-only reverse iterator referring to one past the first element in the container.
+	const_reverse_iterator rend() const { return const_reverse_iterator(leaves() - 1); }
 
 	/**
 	 *  @brief	Finds the number of elements.
 	 *  @param	val	Element to located.
 	 *  @return	Number of elements with specified val.
 	 */
-	int count(const T &val)
+	int count(const T &val) const
 	{
-		iterator first = begin(), last = end();
+		const_iterator first = begin(), last = end();
 		int count = 0;
 		while (first != last)
 		{
@@ -197,15 +372,10 @@ public:
 	 *  @return Iterator to an element with val equivalent to val.
 	 *	If no such element is found, past-the-end iterator is returned.
 	 */
-	iterator find(const T val)
-	{
-		iterator first = begin(), last = end();
-		while (first != last && *first != val)
-		{
-			++first;
-		}
-		return first;
-	}
+	iterator find(const T val) { return begin() + find_index(val); }
+
+	///  Read-only version of find().
+	const_iterator find(const T val) const { return begin() + find_index(val); }
 
 	/**
 	 *  @brief	Finds the beginning of a subsequence matching given val.
@@ -217,30 +387,20 @@ public:
 	 *  pointing to the first element that has a greater value than given val
 	 *  or end() if no such element exists.
 	 */
-	iterator lower_bound(const T &val)
-	{
-		iterator first = begin(), last = end();
-		while (first != last && *first < val)
-		{
-			++first;
-		}
-		return first;
-	}
+	iterator lower_bound(const T &val) { return begin() + lower_bound_index(val); }
+
+	///  Read-only version of lower_bound().
+	const_iterator lower_bound(const T &val) const { return begin() + lower_bound_index(val); }
 
 	/**
 	 *  @brief	Finds the end of a subsequence matching given val.
 	 *  @param  val Element to be located.
 	 *  @return Iterator pointing to the first element greater than val, or end().
 	 */
-	iterator upper_bound(const T &val)
-	{
-		iterator first = begin(), last = end();
-		while (first != last && *first <= val)
-		{
-			++first;
-		}
-		return first;
-	}
+	iterator upper_bound(const T &val) { return begin() + upper_bound_index(val); }
+
+	///  Read-only version of upper_bound().
+	const_iterator upper_bound(const T &val) const { return begin() + upper_bound_index(val); }
 
 	/**
 	 *  @brief	Returns an iterator that points one past the last element in the container. 
@@ -254,25 +414,48 @@ public:
 		return std::make_pair(lower_bound(val), upper_bound(val));
 	}
 
+	///  Read-only version of equal_range().
+	std::pair<const_iterator, const_iterator> equal_range(const T &val) const
+	{
+		return std::make_pair(lower_bound(val), upper_bound(val));
+	}
+
 	///  Returns true if the SegmentTree is empty.
 	bool empty() const { return n_ == 0; }
 
 	///  Returns the size of the SegmentTree.
 	int size() const { return n_; }
 
+	///  Returns the number of bytes allocated for elements and nodes.
+	std::size_t memory_footprint() const
+	{
+		std::size_t count = Layout::node_count(n_);
+		if (cont_)
+			count += n_;
+		return count * sizeof(T);
+	}
+
+	///  Returns a copy of the allocator of the element and node arrays.
+	Alloc get_allocator() const { return alloc_; }
+
+	///  Returns the number of trees sharing the buffers of this tree, 0 if it has none.
+	long use_count() const { return refs_ ? refs_->load(std::memory_order_relaxed) : 0; }
+
 	/**
 	 *  @brief	Finds sum of consecutive elements in a range [queryLeft,queryRight).
 	 *  @param	queryLeft	Left index of range for which sum has to be found.
 	 *  @param	queryRight	Right index of range (Non-inclusive) for which sum has to be found.
 	 *  @return	Sum of range of consecutive elements from [queryLeft, queryRight)
 	 *
+	 *  The elements are combined with Op, so for Min<T> this is the minimum of the range
+	 *  and an empty range gives Op::identity().
 	 *  Takes O(logN) time.
 	 */
-	T sum(int queryLeft, int queryRight)
+	T sum(int queryLeft, int queryRight) const
 	{
 		if (n_ > 0 && queryLeft < queryRight)
-			return sum_util(queryLeft, queryRight - 1, 0, 0, n_ - 1);
-		return 0;
+			return Layout::template sum<Op>(tree_, n_, queryLeft, queryRight);
+		return Op::identity();
 	}
 
 	/**
@@ -280,92 +463,457 @@ public:
 	 *  @param  index	Index of element to be updated.
 	 *  @param  newVal	New value of the element.
 	 * 
-	 *  Takes O(logN) time.
+	 *  Takes O(logN) time, plus O(N) to copy the buffers if they are shared with a copy.
+	 *  Copying the buffers invalidates the iterators of this tree: they keep pointing into
+	 *  the buffers still shared by the copies, and dangle once those are destroyed.
 	 */
 	void update(int index, T newVal)
 	{
-		if (n_ > 0 && index <= newVal)
+		if (index >= 0 && index < n_)
 		{
-			cont_[index] = newVal;
-			update_util(index, newVal, 0, 0, n_ - 1);
+			detach();
+			if (cont_)
+				cont_[index] = newVal;
+			Layout::template update<Op>(tree_, n_, index, newVal);
 		}
 	}
 
-private:
 	/**
-	 *  @brief	Build the segment tree.
-	 *  @param  currentVertice	Indice of current vertice in the segment tree.
-	 *  @param  rangeLeft	Left indice in the input array of range spanned by current vertice.
-	 *  @param  rangeRight	Right indice in the input array of range spanned by current vertice.
+	 *  @brief	Finds the sums of a batch of ranges.
+	 *  @param	ranges	Array of count ranges [first, second), with second non-inclusive.
+	 *  @param	count	Number of ranges.
+	 *  @param	out	Array of count results, out[i] is set to sum(ranges[i].first, ranges[i].second).
 	 *
-	 *  Takes O(N) time - linear in size of input.
+	 *  Ranges are checked once up front and then answered back to back by the layout.
+	 *  RecursiveLayout answers them with a loop instead of the recursive sum_util.
 	 */
-	void build(int currentVertice, int rangeLeft, int rangeRight)
+	void sum_batch(const std::pair<int, int> *ranges, int count, T *out) const
 	{
-		if (rangeLeft == rangeRight)
+		std::vector<int> queries = valid_queries(ranges, count, out);
+		Layout::template sum_batch<Op>(tree_, n_, ranges, queries.data(), queries.size(), out);
+	}
+
+	/**
+	 *  @brief	Finds the sums of a batch of ranges on several threads.
+	 *  @param	ranges	Array of count ranges [first, second), with second non-inclusive.
+	 *  @param	count	Number of ranges.
+	 *  @param	out	Array of count results, out[i] is set to sum(ranges[i].first, ranges[i].second).
+	 *  @param	threads	Largest number of threads to use, including the calling thread.
+	 *
+	 *  The ranges are split into contiguous chunks answered by the workers of
+	 *  ThreadPool::shared(), which all read the same nodes. Nothing in the tree is written,
+	 *  so several threads may call this at once.
+	 */
+	void parallel_sum_batch(const std::pair<int, int> *ranges, int count, T *out, int threads) const
+	{
+		parallel_sum_batch(ranges, count, out, threads, ThreadPool::shared());
+	}
+
+	/**
+	 *  @brief	Finds the sums of a batch of ranges on the threads of pool.
+	 */
+	void parallel_sum_batch(const std::pair<int, int> *ranges, int count, T *out, ThreadPool &pool) const
+	{
+		parallel_sum_batch(ranges, count, out, pool.size(), pool);
+	}
+
+	/**
+	 *  @brief 	Modify a batch of elements in the tree.
+	 *  @param  updates	Array of count pairs of index and new value.
+	 *  @param  count	Number of updates.
+	 *
+	 *  All elements are written first and every vertice above them is then recomputed once,
+	 *  instead of once per update. Updates are applied in order, so the last update of an
+	 *  index wins. Updates with an index outside the tree are ignored.
+	 *  Takes O(K log K + distinct ancestors) time, instead of O(K log N), and memory in
+	 *  O(K) whatever N is. Like update(), it invalidates the iterators of a shared tree.
+	 */
+	void update_batch(const std::pair<int, T> *updates, int count)
+	{
+		std::vector<int> valid;
+		valid.reserve(count);
+		for (int i = 0; i < count; ++i)
 		{
-			tree_[currentVertice] = cont_[rangeLeft];
+			if (updates[i].first >= 0 && updates[i].first < n_)
+			{
+				if (valid.empty())
+					detach();
+				if (cont_)
+					cont_[updates[i].first] = updates[i].second;
+				valid.push_back(i);
+			}
 		}
-		else
+		Layout::template update_batch<Op>(tree_, n_, updates, valid.data(), valid.size());
+	}
+
+	/**
+	 *  @brief  Writes the elements and the built nodes to a stream.
+	 *  @param  out	Binary stream to write to.
+	 *  @return	false if the stream failed.
+	 *
+	 *  Writes a FileHeader and the node array as it is in memory (see file_format.h), each
+	 *  array in a single write, so load() and MappedSegmentTree need no build.
+	 *  T must be trivially copyable.
+	 */
+	bool save(std::ostream &out) const
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "save needs a trivially copyable type");
+		FileHeader header = detail::make_header<T, Op, Layout>(n_);
+		std::size_t nodeBytes = std::size_t(Layout::node_count(n_)) * sizeof(T);
+		std::size_t elementBytes = cont_ ? std::size_t(n_) * sizeof(T) : 0;
+		header.checksum = detail::payload_checksum<T, Layout>(tree_, cont_, n_);
+
+		out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char *>(tree_), nodeBytes);
+		out.write(reinterpret_cast<const char *>(cont_), elementBytes);
+		return !out.fail();
+	}
+
+	/**
+	 *  @brief  Writes the elements and the built nodes to a file.
+	 *  @param  path	File to create or overwrite.
+	 *  @return	false if the file could not be written.
+	 */
+	bool save(const std::string &path) const
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		bool saved = save(file);
+		file.close();
+		return saved && !file.fail();
+	}
+
+	/**
+	 *  @brief  Replaces the tree with one written by save().
+	 *  @param  in	Binary stream to read from.
+	 *  @return	false if the stream does not hold a tree of the same T, Op and Layout, is
+	 *  of a newer format version, is truncated or fails its checksum, or if the arrays
+	 *  cannot be allocated.
+	 *
+	 *  The node array is read as saved, in a single read, so no build is needed. When the
+	 *  stream can seek, a header announcing more bytes than the stream holds is rejected
+	 *  before anything is allocated.
+	 *  Trees saved on a machine of the other byte order are byte swapped when T is an
+	 *  arithmetic type. On failure the tree is left unchanged.
+	 *  T must be trivially copyable.
+	 */
+	bool load(std::istream &in)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "load needs a trivially copyable type");
+		FileHeader header;
+		if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)))
+			return false;
+		bool swapped = header.endianness != FileHeader::byte_order_mark;
+		if (swapped)
+		{
+			if (detail::value_kind<T>() == 0)
+				return false;
+			detail::byteswap_header(header);
+		}
+		if (detail::check_header<T, Op, Layout>(header))
+			return false;
+		std::istream::pos_type start = in.tellg();
+		if (start != std::istream::pos_type(-1) && in.seekg(0, std::ios::end))
+		{
+			std::uint64_t remaining = std::uint64_t(in.tellg() - start);
+			in.seekg(start);
+			if (remaining < detail::payload_size<T, Layout>(int(header.n)))
+				return false;
+		}
+		in.clear();
+
+		SegmentTree loaded(alloc_);
+		try
+		{
+			loaded.allocate(int(header.n));
+		}
+		catch (const std::bad_alloc &)
+		{
+			return false;
+		}
+		std::size_t nodeBytes = std::size_t(Layout::node_count(loaded.n_)) * sizeof(T);
+		std::size_t elementBytes = loaded.cont_ ? std::size_t(loaded.n_) * sizeof(T) : 0;
+		in.read(reinterpret_cast<char *>(loaded.tree_), nodeBytes);
+		in.read(reinterpret_cast<char *>(loaded.cont_), elementBytes);
+		if (!in || detail::payload_checksum<T, Layout>(loaded.tree_, loaded.cont_, loaded.n_) != header.checksum)
+			return false;
+		if (swapped)
 		{
-			int mid = rangeLeft + (rangeRight - rangeLeft) / 2;
-			build(currentVertice * 2 + 1, rangeLeft, mid);
-			build(currentVertice * 2 + 2, mid + 1, rangeRight);
-			tree_[currentVertice] = tree_[currentVertice * 2 + 1] + tree_[currentVertice * 2 + 2];
+			detail::byteswap_values(loaded.tree_, Layout::node_count(loaded.n_), sizeof(T));
+			if (loaded.cont_)
+				detail::byteswap_values(loaded.cont_, loaded.n_, sizeof(T));
 		}
+		release();
+		swap_buffers(loaded);
+		return true;
 	}
 
 	/**
-	 *  @brief  Util function to find sum of consecutive elements in a range.
-	 *  @param  queryLeft	Left indice in the input array of query range.
-	 *  @param  queryRight	Right indice in the input array of query range (inclusive).
-	 *  @param  currentVertice	Indice of current vertice in the segment tree.
-	 *  @param  rangeLeft	Left indice in the input array of range spanned by current vertice.
-	 *  @param  rangeRight	Right indice in the input array of range spanned by current vertice.
-	 *  @return	Sum of range of consecutive elements from [queryLeft, queryRight]
-	 * 
-	 *  Takes O(logN) time.
+	 *  @brief  Replaces the tree with one saved to a file.
+	 *  @return	false if the file cannot be read or does not hold a matching tree.
+	 */
+	bool load(const std::string &path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		return load(file);
+	}
+
+private:
+	/**
+	 *  @brief  Answers the ranges of a batch in chunks spread over at most threads threads of pool.
 	 */
-	T sum_util(int queryLeft, int queryRight, int currentVertice, int rangeLeft, int rangeRight)
+	void parallel_sum_batch(const std::pair<int, int> *ranges, int count, T *out, int threads, ThreadPool &pool) const
 	{
-		if (queryLeft > queryRight)
-			return 0;
-		if (queryLeft == rangeLeft && queryRight == rangeRight)
+		std::vector<int> queries = valid_queries(ranges, count, out);
+		const T *tree = tree_;
+		int n = n_;
+		const int *first = queries.data();
+		pool.parallel_for(threads, 0, queries.size(), detail::parallel_query_grain, [tree, n, ranges, first, out](int chunkFirst, int chunkLast) {
+			Layout::template sum_batch<Op>(tree, n, ranges, first + chunkFirst, chunkLast - chunkFirst, out);
+		});
+	}
+
+	/**
+	 *  @brief  Lists the ranges of a batch that hold elements and sets the result of the others to Op::identity().
+	 */
+	std::vector<int> valid_queries(const std::pair<int, int> *ranges, int count, T *out) const
+	{
+		std::vector<int> queries;
+		queries.reserve(count);
+		for (int i = 0; i < count; ++i)
 		{
-			return tree_[currentVertice];
+			if (n_ > 0 && ranges[i].first < ranges[i].second)
+				queries.push_back(i);
+			else
+				out[i] = Op::identity();
 		}
-		int mid = rangeLeft + (rangeRight - rangeLeft) / 2;
+		return queries;
+	}
 
-		return sum_util(queryLeft, std::min(queryRight, mid), currentVertice * 2 + 1, rangeLeft, mid) +
-			   sum_util(std::max(queryLeft, mid + 1), queryRight, currentVertice * 2 + 2, mid + 1, rangeRight);
+	/**
+	 *  @brief  Index of the first element equal to val, or n_.
+	 */
+	int find_index(const T &val) const
+	{
+		const T *elements = leaves();
+		int i = 0;
+		while (i < n_ && elements[i] != val)
+		{
+			++i;
+		}
+		return i;
 	}
 
 	/**
-	 *  @brief  Util function to modify a specific element in the tree.
-	 *  @param  index	Index of element to be updated.
-	 *  @param  newVal	New value of the element.
-	 *  @param  currentVertice	Indice of current vertice in the segment tree.
-	 *  @param  rangeLeft	Left indice in the input array of range spanned by current vertice.
-	 *  @param  rangeRight 	Right indice in the input array of range spanned by current vertice.
+	 *  @brief  Index of the first element not less than val, or n_.
+	 */
+	int lower_bound_index(const T &val) const
+	{
+		const T *elements = leaves();
+		int i = 0;
+		while (i < n_ && elements[i] < val)
+		{
+			++i;
+		}
+		return i;
+	}
+
+	/**
+	 *  @brief  Index of the first element greater than val, or n_.
+	 */
+	int upper_bound_index(const T &val) const
+	{
+		const T *elements = leaves();
+		int i = 0;
+		while (i < n_ && elements[i] <= val)
+		{
+			++i;
+		}
+		return i;
+	}
+
+	/**
+	 *  @brief  Allocates the arrays for n elements, with no one else sharing them.
 	 *
-	 *  Takes O(logN) time.
+	 *  cont_ is only allocated when the layout does not keep the leaves in tree_. tree_ is
+	 *  value-initialized, since no layout writes every slot (RecursiveLayout leaves about
+	 *  half of its 4n unused, BottomUpLayout node 0), and save() writes and checksums them.
 	 */
-	void update_util(int index, T newVal, int currentVertice, int rangeLeft, int rangeRight)
+	void allocate(int n)
 	{
-		if (rangeLeft == rangeRight)
+		T *cont = Layout::stores_leaves ? nullptr : allocate_array(n);
+		T *tree = nullptr;
+		RefsAlloc refsAlloc(alloc_);
+		try
 		{
-			tree_[currentVertice] = newVal;
+			tree = allocate_array(Layout::node_count(n), true);
+			refs_ = RefsTraits::allocate(refsAlloc, 1);
+		}
+		catch (...)
+		{
+			// Nothing is kept from a failed allocation, so the tree stays empty.
+			if (tree)
+				destroy_array(tree, Layout::node_count(n));
+			if (cont)
+				destroy_array(cont, n);
+			throw;
+		}
+		RefsTraits::construct(refsAlloc, refs_, 1);
+		n_ = n;
+		cont_ = cont;
+		tree_ = tree;
+	}
+
+	/**
+	 *  @brief  Allocates count default constructed T with alloc_.
+	 *
+	 *  Trivial types are left uninitialized, as with new T[count], unless zeroed is set.
+	 */
+	T *allocate_array(std::size_t count, bool zeroed = false)
+	{
+		T *first = AllocTraits::allocate(alloc_, count);
+		if constexpr (std::is_trivially_default_constructible<T>::value)
+		{
+			if (zeroed)
+				std::uninitialized_value_construct_n(first, count);
 		}
 		else
 		{
-			int mid = rangeLeft + (rangeRight - rangeLeft) / 2;
-			if (index <= mid)
-				update_util(index, newVal, currentVertice * 2 + 1, rangeLeft, mid);
-			else
-				update_util(index, newVal, currentVertice * 2 + 2, mid + 1, rangeRight);
+			std::size_t i = 0;
+			try
+			{
+				for (; i < count; ++i)
+				{
+					AllocTraits::construct(alloc_, first + i);
+				}
+			}
+			catch (...)
+			{
+				destroy_array(first, i);
+				throw;
+			}
+		}
+		return first;
+	}
+
+	/**
+	 *  @brief  Destroys and frees an array made by allocate_array.
+	 */
+	void destroy_array(T *first, std::size_t count)
+	{
+		if constexpr (!std::is_trivially_destructible<T>::value)
+		{
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				AllocTraits::destroy(alloc_, first + i);
+			}
+		}
+		AllocTraits::deallocate(alloc_, first, count);
+	}
+
+	/**
+	 *  @brief  Starts sharing the buffers of x, or copies them if x uses another allocator.
+	 */
+	void share(const SegmentTree &x)
+	{
+		if (!x.refs_)
+			return;
+		if (!(alloc_ == x.alloc_))
+		{
+			copy_buffers(x);
+			return;
+		}
+		cont_ = x.cont_;
+		tree_ = x.tree_;
+		n_ = x.n_;
+		refs_ = x.refs_;
+		refs_->fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/**
+	 *  @brief  Allocates buffers of its own holding the elements and nodes of x.
+	 */
+	void copy_buffers(const SegmentTree &x)
+	{
+		allocate(x.n_);
+		if (cont_)
+			std::copy(x.cont_, x.cont_ + n_, cont_);
+		std::copy(x.tree_, x.tree_ + Layout::node_count(n_), tree_);
+	}
 
-			tree_[currentVertice] = tree_[currentVertice * 2 + 1] + tree_[currentVertice * 2 + 2];
+	/**
+	 *  @brief  Stops sharing the buffers, freeing them if no other tree uses them.
+	 */
+	void release()
+	{
+		if (refs_ && refs_->fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			if (cont_)
+				destroy_array(cont_, n_);
+			destroy_array(tree_, Layout::node_count(n_));
+			RefsAlloc refsAlloc(alloc_);
+			RefsTraits::destroy(refsAlloc, refs_);
+			RefsTraits::deallocate(refsAlloc, refs_, 1);
 		}
+		cont_ = nullptr;
+		tree_ = nullptr;
+		refs_ = nullptr;
+		n_ = 0;
+	}
+
+	/**
+	 *  @brief  Gives this tree its own copy of the buffers before they are modified.
+	 */
+	void detach()
+	{
+		if (!refs_ || refs_->load(std::memory_order_acquire) == 1)
+			return;
+		SegmentTree copy(alloc_);
+		copy.copy_buffers(*this);
+		release();
+		swap_buffers(copy);
+	}
+
+	/**
+	 *  @brief  Exchanges the buffers of this tree and x, but not the allocators.
+	 */
+	void swap_buffers(SegmentTree &x) noexcept
+	{
+		std::swap(cont_, x.cont_);
+		std::swap(tree_, x.tree_);
+		std::swap(n_, x.n_);
+		std::swap(refs_, x.refs_);
+	}
+
+	/**
+	 *  @brief  Returns a pointer to the first element, either in cont_ or in the leaves of tree_.
+	 */
+	T *leaves() const
+	{
+		if constexpr (Layout::stores_leaves)
+			return tree_ + Layout::leaf_offset(n_);
+		else
+			return cont_;
 	}
 };
-} // namespace st
\ No newline at end of file
+
+/**
+ *  @brief  Exchanges the buffers of two segment trees.
+ */
+template <typename T, typename Op, typename Layout, typename Alloc>
+void swap(SegmentTree<T, Op, Layout, Alloc> &a, SegmentTree<T, Op, Layout, Alloc> &b) noexcept
+{
+	a.swap(b);
+}
+
+namespace pmr
+{
+/**
+ *  @brief  SegmentTree whose arrays come from a std::pmr::memory_resource.
+ *
+ *  st::pmr::SegmentTree<int> tree(input, n, &arena);
+ */
+template <typename T, typename Op = Sum<T>, typename Layout = RecursiveLayout>
+using SegmentTree = st::SegmentTree<T, Op, Layout, std::pmr::polymorphic_allocator<T>>;
+} // namespace pmr
+} // namespace st
+#endif // SEGMENT_TREE_SEGMENT_TREE_H
@@ -0,0 +1,203 @@
+#ifndef SEGMENT_TREE_SEGMENT_TREE_2D_H
+#define SEGMENT_TREE_SEGMENT_TREE_2D_H
+#include "operations.h"
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+namespace st
+{
+/*
+CLASS SUMMARY
+
+	template <typename T, typename Op = Sum<T>>
+	class SegmentTree2D;
+
+	// Constructors.
+	SegmentTree2D();
+	SegmentTree2D(int rows, int columns);						// Every element Op::identity().
+	SegmentTree2D(const T *input, int rows, int columns);		// Row-major input.
+
+	// Capacity
+	bool empty() const;
+	int rows() const;
+	int columns() const;
+	std::size_t memory_footprint() const;
+
+	// Specialized algorithms.
+	T sum(int rowTop, int columnLeft, int rowBottom, int columnRight) const;
+	void update(int row, int column, T newVal);
+	T operator()(int row, int column) const;
+*/
+
+/**
+ *  @brief  Segment tree over a matrix, answering sub-rectangle queries.
+ *
+ *  A segment tree over the rows whose every vertice is a segment tree over the columns,
+ *  both in BottomUpLayout. All of it is one row-major array of 2 * rows by 2 * columns
+ *  nodes: node (i, j) aggregates the rows of row vertice i and the columns of column
+ *  vertice j, element (r, c) is node (rows + r, columns + c), and the children of (i, j)
+ *  are (2i, j) and (2i + 1, j) across rows and (i, 2j) and (i, 2j + 1) across columns.
+ *
+ *  A rectangle is covered by O(log rows) row vertices, each queried over O(log columns)
+ *  column vertices, so sum() and update() take O(log rows * log columns) time.
+ *  The rectangle is combined in no particular order, so Op must be commutative, as all
+ *  the operations of operations.h are.
+ */
+template <typename T, typename Op = Sum<T>>
+class SegmentTree2D
+{
+private:
+	// Underlying data structure, 2 * rows_ rows of 2 * columns_ nodes.
+	std::vector<T> tree_;
+	int rows_;
+	int columns_;
+
+public:
+	// Constructors.
+
+	/**
+	 *  @brief  Creates a Segment Tree with no elements.
+	 */
+	explicit SegmentTree2D() : rows_(0), columns_(0) {}
+
+	/**
+	 *  @brief  Creates a segment tree over a rows by columns matrix of Op::identity().
+	 */
+	SegmentTree2D(int rows, int columns)
+		: tree_(4 * std::size_t(std::max(rows, 0)) * std::max(columns, 0), Op::identity()),
+		  rows_(std::max(rows, 0)), columns_(std::max(columns, 0))
+	{
+	}
+
+	/**
+	 *  @brief  Creates a segment tree from a matrix.
+	 *  @param  input	rows * columns elements, row after row.
+	 *  @param  rows	Number of rows.
+	 *  @param  columns	Number of columns.
+	 *
+	 *  This is linear in the number of elements.
+	 */
+	SegmentTree2D(const T *input, int rows, int columns) : SegmentTree2D(rows, columns)
+	{
+		for (int r = 0; r < rows_; ++r)
+		{
+			T *row = node(rows_ + r);
+			std::copy(input + std::size_t(r) * columns_, input + std::size_t(r + 1) * columns_, row + columns_);
+			for (int j = columns_ - 1; j > 0; --j)
+			{
+				row[j] = Op::combine(row[2 * j], row[2 * j + 1]);
+			}
+		}
+		for (int i = rows_ - 1; i > 0; --i)
+		{
+			T *row = node(i);
+			const T *top = node(2 * i), *bottom = node(2 * i + 1);
+			for (int j = 1; j < 2 * columns_; ++j)
+			{
+				row[j] = Op::combine(top[j], bottom[j]);
+			}
+		}
+	}
+
+	///  Returns true if the matrix has no elements.
+	bool empty() const { return rows_ == 0 || columns_ == 0; }
+
+	///  Returns the number of rows.
+	int rows() const { return rows_; }
+
+	///  Returns the number of columns.
+	int columns() const { return columns_; }
+
+	///  Returns the number of bytes used by the nodes.
+	std::size_t memory_footprint() const { return tree_.size() * sizeof(T); }
+
+	///  Returns the element at (row, column).
+	T operator()(int row, int column) const { return node(rows_ + row)[columns_ + column]; }
+
+	/**
+	 *  @brief	Finds sum of the elements in a rectangle of rows [rowTop, rowBottom) and columns [columnLeft, columnRight).
+	 *  @param	rowTop	First row of the rectangle.
+	 *  @param	columnLeft	First column of the rectangle.
+	 *  @param	rowBottom	Row past the rectangle (Non-inclusive).
+	 *  @param	columnRight	Column past the rectangle (Non-inclusive).
+	 *
+	 *  Takes O(log rows * log columns) time.
+	 */
+	T sum(int rowTop, int columnLeft, int rowBottom, int columnRight) const
+	{
+		rowTop = std::max(rowTop, 0);
+		columnLeft = std::max(columnLeft, 0);
+		rowBottom = std::min(rowBottom, rows_);
+		columnRight = std::min(columnRight, columns_);
+		T result = Op::identity();
+		if (columnLeft >= columnRight)
+			return result;
+		for (rowTop += rows_, rowBottom += rows_; rowTop < rowBottom; rowTop >>= 1, rowBottom >>= 1)
+		{
+			if (rowTop & 1)
+				result = Op::combine(result, sum_row(rowTop++, columnLeft, columnRight));
+			if (rowBottom & 1)
+				result = Op::combine(result, sum_row(--rowBottom, columnLeft, columnRight));
+		}
+		return result;
+	}
+
+	/**
+	 *  @brief 	Modify a specific element in the matrix.
+	 *  @param  row	Row of element to be updated.
+	 *  @param  column	Column of element to be updated.
+	 *  @param  newVal	New value of the element.
+	 *
+	 *  Recomputes the column path of the element in its row and then in every ancestor
+	 *  row. Takes O(log rows * log columns) time.
+	 */
+	void update(int row, int column, T newVal)
+	{
+		if (row < 0 || row >= rows_ || column < 0 || column >= columns_)
+			return;
+		int i = rows_ + row;
+		T *leaves = node(i);
+		leaves[columns_ + column] = newVal;
+		for (int j = (columns_ + column) / 2; j > 0; j /= 2)
+		{
+			leaves[j] = Op::combine(leaves[2 * j], leaves[2 * j + 1]);
+		}
+		for (i /= 2; i > 0; i /= 2)
+		{
+			T *current = node(i);
+			const T *top = node(2 * i), *bottom = node(2 * i + 1);
+			for (int j = columns_ + column; j > 0; j /= 2)
+			{
+				current[j] = Op::combine(top[j], bottom[j]);
+			}
+		}
+	}
+
+private:
+	/**
+	 *  @brief  Returns the first node of row vertice i.
+	 */
+	T *node(int i) { return tree_.data() + std::size_t(i) * 2 * columns_; }
+
+	///  Read-only version of node().
+	const T *node(int i) const { return tree_.data() + std::size_t(i) * 2 * columns_; }
+
+	/**
+	 *  @brief  Bottom-up sum of the columns [columnLeft, columnRight) of row vertice i.
+	 */
+	T sum_row(int i, int columnLeft, int columnRight) const
+	{
+		const T *row = node(i);
+		T result = Op::identity();
+		for (columnLeft += columns_, columnRight += columns_; columnLeft < columnRight; columnLeft >>= 1, columnRight >>= 1)
+		{
+			if (columnLeft & 1)
+				result = Op::combine(result, row[columnLeft++]);
+			if (columnRight & 1)
+				result = Op::combine(result, row[--columnRight]);
+		}
+		return result;
+	}
+};
+} // namespace st
+#endif // SEGMENT_TREE_SEGMENT_TREE_2D_H
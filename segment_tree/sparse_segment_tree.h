@@ -0,0 +1,193 @@
+#ifndef SEGMENT_TREE_SPARSE_SEGMENT_TREE_H
+#define SEGMENT_TREE_SPARSE_SEGMENT_TREE_H
+#include "operations.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+namespace st
+{
+/*
+CLASS SUMMARY
+
+	template <typename T, typename Op = Sum<T>>
+	class SparseSegmentTree;
+
+	// Constructors.
+	explicit SparseSegmentTree(long long size);
+
+	// Capacity
+	bool empty() const;
+	long long size() const;
+	std::size_t node_count() const;
+	std::size_t memory_footprint() const;
+	void reserve(std::size_t nodes);
+
+	// Specialized algorithms.
+	T sum(long long queryLeft, long long queryRight) const;
+	void update(long long index, T newVal);
+*/
+
+/**
+ *  @brief  Segment tree over a huge index range [0, size) whose nodes are created on first update.
+ *
+ *  Every element starts as Op::identity() and no node exists for it. update() creates the
+ *  missing vertices on the path to its element, at most one per level below the root, so
+ *  memory grows with the paths touched and not with size. An update creates at most 62
+ *  nodes in a range of 2^62 and at most 63 in the largest range; measured over 2^18 random
+ *  indices in [0, 2^62) it creates about 46 on average, and fewer as more paths are shared.
+ *
+ *  Nodes come from one pool, a vector linked by 32 bit indices, so a node is the value and
+ *  8 bytes of links and the pool grows by doubling instead of one allocation per node.
+ *  Index 0 is a sentinel holding Op::identity(), standing for every child not created yet.
+ */
+template <typename T, typename Op = Sum<T>>
+class SparseSegmentTree
+{
+private:
+	/**
+	 *  @brief  A vertice: the sum of its range and the nodes of its two halves, 0 if absent.
+	 */
+	struct Node
+	{
+		T value;
+		std::uint32_t left, right;
+	};
+
+	// Node pool, nodes_[0] being the sentinel and nodes_[1] the root.
+	std::vector<Node> nodes_;
+	long long size_;
+
+public:
+	// Constructors.
+
+	/**
+	 *  @brief  Creates a tree over [0, size) with every element Op::identity().
+	 *  @param  size	Number of indices, up to the largest long long.
+	 *
+	 *  Takes O(1) time and allocates only the sentinel and the root.
+	 */
+	explicit SparseSegmentTree(long long size) : size_(std::max(size, 0LL))
+	{
+		nodes_.push_back(Node{Op::identity(), 0, 0});
+		nodes_.push_back(Node{Op::identity(), 0, 0});
+	}
+
+	///  Returns true if the index range is empty.
+	bool empty() const { return size_ == 0; }
+
+	///  Returns the number of indices, as given to the constructor.
+	long long size() const { return size_; }
+
+	///  Returns the number of nodes created, the sentinel and the root included.
+	std::size_t node_count() const { return nodes_.size(); }
+
+	///  Returns the number of bytes used by the node pool.
+	std::size_t memory_footprint() const { return nodes_.capacity() * sizeof(Node); }
+
+	/**
+	 *  @brief  Makes room in the pool for nodes nodes, so updates do not reallocate it.
+	 */
+	void reserve(std::size_t nodes) { nodes_.reserve(nodes); }
+
+	/**
+	 *  @brief	Finds sum of consecutive elements in a range [queryLeft,queryRight).
+	 *  @param	queryLeft	Left index of range for which sum has to be found.
+	 *  @param	queryRight	Right index of range (Non-inclusive) for which sum has to be found.
+	 *  @return	Sum of range of consecutive elements from [queryLeft, queryRight)
+	 *
+	 *  Subtrees with no node are skipped as identities.
+	 *  Takes O(log size) time.
+	 */
+	T sum(long long queryLeft, long long queryRight) const
+	{
+		queryLeft = std::max(queryLeft, 0LL);
+		queryRight = std::min(queryRight, size_);
+		if (queryLeft >= queryRight)
+			return Op::identity();
+		return sum_util(1, queryLeft, queryRight, 0, size_);
+	}
+
+	/**
+	 *  @brief 	Modify a specific element in the tree.
+	 *  @param  index	Index of element to be updated, in [0, size).
+	 *  @param  newVal	New value of the element.
+	 *  @throw  std::length_error if the pool already holds 2^32 - 1 nodes.
+	 *
+	 *  Creates the missing vertices on the path to the element.
+	 *  Takes O(log size) time.
+	 */
+	void update(long long index, T newVal)
+	{
+		if (index < 0 || index >= size_)
+			return;
+		// Vertices from the root down to the element, at most one per bit of size_.
+		std::uint32_t path[64];
+		int depth = 0;
+		std::uint32_t node = 1;
+		long long rangeLeft = 0, rangeRight = size_;
+		while (rangeRight - rangeLeft > 1)
+		{
+			path[depth++] = node;
+			long long mid = rangeLeft + (rangeRight - rangeLeft) / 2;
+			bool right = index >= mid;
+			std::uint32_t child = right ? nodes_[node].right : nodes_[node].left;
+			if (child == 0)
+			{
+				child = make_node();
+				if (right)
+					nodes_[node].right = child;
+				else
+					nodes_[node].left = child;
+			}
+			if (right)
+				rangeLeft = mid;
+			else
+				rangeRight = mid;
+			node = child;
+		}
+		nodes_[node].value = newVal;
+		while (depth > 0)
+		{
+			Node &parent = nodes_[path[--depth]];
+			parent.value = Op::combine(nodes_[parent.left].value, nodes_[parent.right].value);
+		}
+	}
+
+private:
+	/**
+	 *  @brief  Util function to find sum of consecutive elements in a range.
+	 *  @param  node	Node of current vertice, 0 if it has none.
+	 *  @param  queryLeft	Left indice of query range.
+	 *  @param  queryRight	Right indice of query range (Non-inclusive).
+	 *  @param  rangeLeft	Left indice of range spanned by current vertice.
+	 *  @param  rangeRight	Right indice of range spanned by current vertice (Non-inclusive).
+	 *
+	 *  Takes O(log size) time.
+	 */
+	T sum_util(std::uint32_t node, long long queryLeft, long long queryRight, long long rangeLeft, long long rangeRight) const
+	{
+		if (node == 0 || queryLeft >= queryRight)
+			return Op::identity();
+		if (queryLeft == rangeLeft && queryRight == rangeRight)
+			return nodes_[node].value;
+		long long mid = rangeLeft + (rangeRight - rangeLeft) / 2;
+		return Op::combine(sum_util(nodes_[node].left, queryLeft, std::min(queryRight, mid), rangeLeft, mid),
+						   sum_util(nodes_[node].right, std::max(queryLeft, mid), queryRight, mid, rangeRight));
+	}
+
+	/**
+	 *  @brief  Appends an identity node to the pool and returns its index.
+	 */
+	std::uint32_t make_node()
+	{
+		if (nodes_.size() >= std::numeric_limits<std::uint32_t>::max())
+			throw std::length_error("SparseSegmentTree: node pool is full");
+		nodes_.push_back(Node{Op::identity(), 0, 0});
+		return nodes_.size() - 1;
+	}
+};
+} // namespace st
+#endif // SEGMENT_TREE_SPARSE_SEGMENT_TREE_H
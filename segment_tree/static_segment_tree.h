@@ -0,0 +1,194 @@
+#ifndef SEGMENT_TREE_STATIC_SEGMENT_TREE_H
+#define SEGMENT_TREE_STATIC_SEGMENT_TREE_H
+#include "iterator.h"
+#include "layout.h"
+#include "operations.h"
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+namespace st
+{
+/*
+CLASS SUMMARY
+
+	template <typename T, typename Op = Sum<T>>
+	class StaticSegmentTree;
+
+	// Constructors.
+	StaticSegmentTree();
+	StaticSegmentTree(const T *input, int n);
+	StaticSegmentTree(_InputIterator first, _InputIterator last);
+
+	// Iterators.
+	const_iterator begin() const;
+	const_iterator end() const;
+
+	// Capacity
+	bool empty() const;
+	int size() const;
+	std::size_t memory_footprint() const;
+
+	// Specialized algorithms.
+	T sum(int queryLeft, int queryRight) const;		// One or two reads, no update.
+*/
+
+/**
+ *  @brief  Read-only range queries over elements that never change, in O(1).
+ *
+ *  For an invertible Op over an integral T (Sum, BitXor; see ExactInverse) the table holds
+ *  the n + 1 prefix sums, and a range is the prefix up to its end with the prefix before it
+ *  taken out by Op::inverse, which assumes Op is commutative as Sum and BitXor are. Prefix
+ *  sums of a signed T are kept unsigned, so they may wrap around while every range that
+ *  fits in T stays exact.
+ *
+ *  Any other Op, and floating point sums, get a disjoint sparse table: a float range taken
+ *  out of a larger prefix would lose the low bits the prefix had no room for. Level h cuts
+ *  the elements into blocks of 2^(h+1) and, for each element, stores the sum from it to
+ *  the middle of its block: up to the middle in the left half, from the middle in the
+ *  right half. The bounds l and r of a range of two or more elements first fall in
+ *  different halves of a block at level highest_bit(l ^ r), where the range is the left
+ *  half sum of l followed by the right half sum of r. Elements are combined in order, so
+ *  Op needs only be associative, and the table takes n * ceil(log2 n) slots, built in
+ *  O(N logN).
+ *
+ *  Either way a sum() reads one or two slots, with no loop and no recursion.
+ */
+template <typename T, typename Op = Sum<T>>
+class StaticSegmentTree
+{
+public:
+	typedef Iterator<const T> const_iterator;
+
+private:
+	typedef typename ExactInverse<T, Op>::type Prefix;
+	typedef typename ExactInverse<T, Op>::op PrefixOp;
+	static constexpr bool uses_prefix_sums = ExactInverse<T, Op>::value;
+
+	// Elements, as given.
+	std::vector<T> cont_;
+	// Prefix sums, empty unless uses_prefix_sums.
+	std::vector<Prefix> prefix_;
+	// Levels of the disjoint sparse table one after the other, empty if uses_prefix_sums.
+	std::vector<T> table_;
+	int n_;
+
+public:
+	// Constructors.
+
+	/**
+	 *  @brief  Creates a Segment Tree with no elements.
+	 */
+	explicit StaticSegmentTree() : n_(0) {}
+
+	/**
+	 *  @brief  Creates a segment tree from an input array.
+	 *  @param  input	Input array whose elements are used to build the segment tree.
+	 *  @param  n	Number of elements of input array to use.
+	 *
+	 *  This is linear in N for prefix sums and O(N logN) otherwise.
+	 */
+	StaticSegmentTree(const T *input, int n) : cont_(input, input + std::max(n, 0)), n_(cont_.size())
+	{
+		build();
+	}
+
+	/**
+	 *  @brief  Builds a segment tree from a range.
+	 *  @param  first	An input iterator.
+	 *  @param  last	An input iterator.
+	 *
+	 *  This is linear in N for prefix sums and O(N logN) otherwise.
+	 */
+	template <typename _InputIterator>
+	StaticSegmentTree(_InputIterator first, _InputIterator last) : cont_(first, last), n_(cont_.size())
+	{
+		build();
+	}
+
+	///  Returns a read-only iterator referring to the first element in the container.
+	const_iterator begin() const { return const_iterator(cont_.data()); }
+
+	///  Returns a read-only iterator that points one past the last element in the container.
+	const_iterator end() const { return const_iterator(cont_.data() + n_); }
+
+	///  Returns true if the StaticSegmentTree is empty.
+	bool empty() const { return n_ == 0; }
+
+	///  Returns the size of the StaticSegmentTree.
+	int size() const { return n_; }
+
+	///  Returns the number of bytes used by the elements and the table.
+	std::size_t memory_footprint() const { return (cont_.size() + table_.size()) * sizeof(T) + prefix_.size() * sizeof(Prefix); }
+
+	/**
+	 *  @brief	Finds sum of consecutive elements in a range [queryLeft,queryRight).
+	 *  @param	queryLeft	Left index of range for which sum has to be found.
+	 *  @param	queryRight	Right index of range (Non-inclusive) for which sum has to be found.
+	 *  @return	Sum of range of consecutive elements from [queryLeft, queryRight)
+	 *
+	 *  Takes O(1) time.
+	 */
+	T sum(int queryLeft, int queryRight) const
+	{
+		queryLeft = std::max(queryLeft, 0);
+		queryRight = std::min(queryRight, n_);
+		if (queryLeft >= queryRight)
+			return Op::identity();
+		if constexpr (uses_prefix_sums)
+		{
+			return T(PrefixOp::inverse(prefix_[queryRight], prefix_[queryLeft]));
+		}
+		else
+		{
+			int last = queryRight - 1;
+			if (queryLeft == last)
+				return cont_[queryLeft];
+			const T *level = table_.data() + std::size_t(detail::highest_bit(queryLeft ^ last)) * n_;
+			return Op::combine(level[queryLeft], level[last]);
+		}
+	}
+
+private:
+	/**
+	 *  @brief  Computes the prefix sums or the disjoint sparse table from cont_.
+	 */
+	void build()
+	{
+		if constexpr (uses_prefix_sums)
+		{
+			prefix_.assign(n_ + 1, PrefixOp::identity());
+			for (int i = 0; i < n_; ++i)
+			{
+				prefix_[i + 1] = PrefixOp::combine(prefix_[i], Prefix(cont_[i]));
+			}
+		}
+		else
+		{
+			int levels = n_ > 1 ? detail::highest_bit(n_ - 1) + 1 : 0;
+			table_.resize(std::size_t(levels) * n_);
+			for (int h = 0; h < levels; ++h)
+			{
+				T *level = table_.data() + std::size_t(h) * n_;
+				int half = 1 << h;
+				// A block whose right half is empty holds no range of this level.
+				for (int mid = half; mid < n_; mid += 2 * half)
+				{
+					// Left half, from each element up to the middle.
+					level[mid - 1] = cont_[mid - 1];
+					for (int i = mid - 2; i >= mid - half; --i)
+					{
+						level[i] = Op::combine(cont_[i], level[i + 1]);
+					}
+					// Right half, from the middle up to each element.
+					level[mid] = cont_[mid];
+					for (int i = mid + 1; i < std::min(mid + half, n_); ++i)
+					{
+						level[i] = Op::combine(level[i - 1], cont_[i]);
+					}
+				}
+			}
+		}
+	}
+};
+} // namespace st
+#endif // SEGMENT_TREE_STATIC_SEGMENT_TREE_H
@@ -0,0 +1,169 @@
+#ifndef SEGMENT_TREE_THREAD_POOL_H
+#define SEGMENT_TREE_THREAD_POOL_H
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+namespace st
+{
+/*
+CLASS SUMMARY
+
+	class ThreadPool;
+
+	A fixed set of worker threads that run the chunks of parallel_for calls, so repeated
+	parallel batches do not pay for starting threads. Several threads may call
+	parallel_for on the same pool at once.
+
+	explicit ThreadPool(int threads);
+	~ThreadPool();
+
+	int size() const;
+	static ThreadPool &shared();
+
+	void parallel_for(int threads, int first, int last, int grain, Function function);
+*/
+class ThreadPool
+{
+private:
+	std::vector<std::thread> workers_;
+	std::deque<std::function<void()>> tasks_;
+	std::mutex mutex_;
+	std::condition_variable available_;
+	bool stopping_;
+
+public:
+	/**
+	 *  @brief  Starts a pool able to run threads chunks at once.
+	 *  @param  threads	Number of threads, including the thread calling parallel_for,
+	 *  so threads - 1 workers are started.
+	 */
+	explicit ThreadPool(int threads) : stopping_(false)
+	{
+		for (int i = 1; i < threads; ++i)
+		{
+			workers_.emplace_back([this] { work(); });
+		}
+	}
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	/**
+	 *  @brief  Finishes the queued chunks and joins the workers.
+	 */
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stopping_ = true;
+		}
+		available_.notify_all();
+		for (std::thread &worker : workers_)
+		{
+			worker.join();
+		}
+	}
+
+	///  Returns the number of chunks the pool runs at once, the calling thread included.
+	int size() const { return workers_.size() + 1; }
+
+	/**
+	 *  @brief  A pool with one thread per hardware thread, started on first use.
+	 */
+	static ThreadPool &shared()
+	{
+		static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+		return pool;
+	}
+
+	/**
+	 *  @brief  Calls function(chunkFirst, chunkLast) on disjoint chunks covering [first, last).
+	 *  @param  threads	Largest number of chunks, capped by size().
+	 *  @param  grain	Smallest number of items in a chunk.
+	 *
+	 *  The calling thread runs the first chunk and then helps with queued chunks until
+	 *  every chunk of this call is done.
+	 */
+	template <typename Function>
+	void parallel_for(int threads, int first, int last, int grain, Function function)
+	{
+		int chunks = std::min(std::min(threads, size()), (last - first) / grain);
+		if (chunks <= 1)
+		{
+			if (first < last)
+				function(first, last);
+			return;
+		}
+
+		std::mutex doneMutex;
+		std::condition_variable doneSignal;
+		int remaining = chunks - 1;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			for (int chunk = 1; chunk < chunks; ++chunk)
+			{
+				int chunkFirst = first + (long long)(last - first) * chunk / chunks;
+				int chunkLast = first + (long long)(last - first) * (chunk + 1) / chunks;
+				tasks_.emplace_back([&, chunkFirst, chunkLast] {
+					function(chunkFirst, chunkLast);
+					std::lock_guard<std::mutex> doneLock(doneMutex);
+					if (--remaining == 0)
+						doneSignal.notify_one();
+				});
+			}
+		}
+		available_.notify_all();
+
+		function(first, first + (int)((long long)(last - first) / chunks));
+		while (run_one())
+		{
+		}
+		std::unique_lock<std::mutex> doneLock(doneMutex);
+		doneSignal.wait(doneLock, [&remaining] { return remaining == 0; });
+	}
+
+private:
+	/**
+	 *  @brief  Runs one queued chunk on the calling thread.
+	 *  @return false if the queue was empty.
+	 */
+	bool run_one()
+	{
+		std::function<void()> task;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (tasks_.empty())
+				return false;
+			task = std::move(tasks_.front());
+			tasks_.pop_front();
+		}
+		task();
+		return true;
+	}
+
+	/**
+	 *  @brief  Worker loop, running chunks until the pool is destroyed.
+	 */
+	void work()
+	{
+		for (;;)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				available_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+				if (tasks_.empty())
+					return;
+				task = std::move(tasks_.front());
+				tasks_.pop_front();
+			}
+			task();
+		}
+	}
+};
+} // namespace st
+#endif // SEGMENT_TREE_THREAD_POOL_H
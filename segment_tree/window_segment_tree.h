@@ -0,0 +1,157 @@
+#ifndef SEGMENT_TREE_WINDOW_SEGMENT_TREE_H
+#define SEGMENT_TREE_WINDOW_SEGMENT_TREE_H
+#include "operations.h"
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+namespace st
+{
+/*
+CLASS SUMMARY
+
+	template <typename T, typename Op = Sum<T>>
+	class WindowSegmentTree;
+
+	// Constructors.
+	explicit WindowSegmentTree(int capacity);
+
+	// Capacity
+	bool empty() const;
+	int size() const;
+	int capacity() const;
+
+	// Specialized algorithms.
+	void push(const T &val);							// Overwrites the oldest element when full.
+	T window_sum(int lastK) const;						// The lastK newest elements.
+	T sum(int queryLeft, int queryRight) const;			// Logical indices, 0 the oldest.
+	T operator[](int index) const;
+*/
+
+/**
+ *  @brief  Segment tree over a sliding window of the newest capacity elements.
+ *
+ *  The leaves are a ring buffer in BottomUpLayout: leaf i at capacity + i, the parent of i
+ *  at i / 2. push() writes the slot after the newest element, which once the window is full
+ *  is the oldest one, and recomputes its path, so nothing is ever moved or rebuilt.
+ *
+ *  Queries use logical indices, 0 being the oldest element held and size() - 1 the newest.
+ *  A logical range maps to at most two physical ranges, one before and one after the
+ *  wrap-around, combined oldest first, so non-commutative operations stay in order.
+ */
+template <typename T, typename Op = Sum<T>>
+class WindowSegmentTree
+{
+private:
+	// Underlying data structure for the segment tree, 2 * capacity_ nodes.
+	std::vector<T> tree_;
+	int capacity_;
+	// Number of elements held, at most capacity_.
+	int n_;
+	// Slot of the next push, the oldest element once the window is full.
+	int head_;
+
+public:
+	// Constructors.
+
+	/**
+	 *  @brief  Creates an empty window of capacity elements.
+	 *  @param  capacity	Number of newest elements kept.
+	 */
+	explicit WindowSegmentTree(int capacity)
+		: tree_(2 * std::max(capacity, 0), Op::identity()), capacity_(std::max(capacity, 0)), n_(0), head_(0)
+	{
+	}
+
+	///  Returns true if the window holds no elements.
+	bool empty() const { return n_ == 0; }
+
+	///  Returns the number of elements held, at most capacity().
+	int size() const { return n_; }
+
+	///  Returns the number of newest elements kept.
+	int capacity() const { return capacity_; }
+
+	/**
+	 *  @brief 	Adds the newest element, dropping the oldest one if the window is full.
+	 *  @param  val	The new element, at logical index size() - 1 once added.
+	 *
+	 *  Takes O(log capacity) time.
+	 */
+	void push(const T &val)
+	{
+		if (capacity_ == 0)
+			return;
+		int i = capacity_ + head_;
+		tree_[i] = val;
+		for (i /= 2; i > 0; i /= 2)
+		{
+			tree_[i] = Op::combine(tree_[2 * i], tree_[2 * i + 1]);
+		}
+		head_ = head_ + 1 == capacity_ ? 0 : head_ + 1;
+		n_ = std::min(n_ + 1, capacity_);
+	}
+
+	/**
+	 *  @brief	Finds sum of the newest elements.
+	 *  @param	lastK	Number of newest elements, capped by size().
+	 *
+	 *  Takes O(log capacity) time.
+	 */
+	T window_sum(int lastK) const
+	{
+		return sum(n_ - std::min(std::max(lastK, 0), n_), n_);
+	}
+
+	/**
+	 *  @brief	Finds sum of consecutive elements in a range [queryLeft,queryRight) of logical indices.
+	 *  @param	queryLeft	Left index of range, 0 being the oldest element held.
+	 *  @param	queryRight	Right index of range (Non-inclusive).
+	 *  @return	Sum of range of consecutive elements from [queryLeft, queryRight)
+	 *
+	 *  Takes O(log capacity) time.
+	 */
+	T sum(int queryLeft, int queryRight) const
+	{
+		queryLeft = std::max(queryLeft, 0);
+		queryRight = std::min(queryRight, n_);
+		if (queryLeft >= queryRight)
+			return Op::identity();
+		int first = physical(queryLeft), last = physical(queryRight - 1) + 1;
+		if (first < last)
+			return sum_slots(first, last);
+		return Op::combine(sum_slots(first, capacity_), sum_slots(0, last));
+	}
+
+	/**
+	 *  @brief  Returns the element at a logical index, 0 being the oldest.
+	 */
+	T operator[](int index) const { return tree_[capacity_ + physical(index)]; }
+
+private:
+	/**
+	 *  @brief  Slot of a logical index.
+	 */
+	int physical(int index) const
+	{
+		int slot = head_ - n_ + index;
+		return slot < 0 ? slot + capacity_ : slot;
+	}
+
+	/**
+	 *  @brief  Bottom-up sum of the slots [queryLeft, queryRight), as in BottomUpLayout::sum.
+	 */
+	T sum_slots(int queryLeft, int queryRight) const
+	{
+		T resultLeft = Op::identity(), resultRight = Op::identity();
+		for (queryLeft += capacity_, queryRight += capacity_; queryLeft < queryRight; queryLeft >>= 1, queryRight >>= 1)
+		{
+			if (queryLeft & 1)
+				resultLeft = Op::combine(resultLeft, tree_[queryLeft++]);
+			if (queryRight & 1)
+				resultRight = Op::combine(tree_[--queryRight], resultRight);
+		}
+		return Op::combine(resultLeft, resultRight);
+	}
+};
+} // namespace st
+#endif // SEGMENT_TREE_WINDOW_SEGMENT_TREE_H
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <vector>
 #include "../segment_tree/segment_tree.h"
+#include "../segment_tree/window_segment_tree.h"
 using namespace std;
 
 template <typename ptr_t>
@@ -94,5 +95,16 @@ int main()
 	}
 	std::cout << "Sum of entire input : ";
 	cout << transactions.sum(0, transactions.size()) << std::endl;
+
+	// Keep only the last 5 days, each new day replacing the oldest one.
+	cout << std::endl
+		 << "Rolling sums over the last 5 days" << std::endl;
+	st::WindowSegmentTree<float> last_days(5);
+	for (float day : daily_transactions)
+	{
+		last_days.push(day);
+		cout << "Day total " << day << ":\tlast 3 days " << last_days.window_sum(3)
+			 << "\tlast 5 days " << last_days.window_sum(5) << std::endl;
+	}
 	return 0;
 }
\ No newline at end of file
@@ -1,6 +1,27 @@
 #include <vector>
 #include <iostream>
+#include <string>
+#include <limits>
+#include <algorithm>
+#include <map>
+#include <thread>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
 #include "../segment_tree/segment_tree.h"
+#include "../segment_tree/lazy_segment_tree.h"
+#include "../segment_tree/concurrent_segment_tree.h"
+#include "../segment_tree/persistent_segment_tree.h"
+#include "../segment_tree/huge_page_allocator.h"
+#include "../segment_tree/mapped_segment_tree.h"
+#include "../segment_tree/growable_segment_tree.h"
+#include "../segment_tree/window_segment_tree.h"
+#include "../segment_tree/sparse_segment_tree.h"
+#include "../segment_tree/keyed_segment_tree.h"
+#include "../segment_tree/segment_tree_2d.h"
+#include "../segment_tree/fenwick_tree.h"
+#include "../segment_tree/static_segment_tree.h"
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest.h"
 using namespace st;
@@ -11,6 +32,33 @@ void print_time(std::vector<T> &vect, SegmentTree<T> &seg, long int l, long int
 template <typename T, typename ptr_t>
 T accumulate(ptr_t first, ptr_t last, T init);
 
+template <typename Op, typename Layout, typename T>
+void check_operation(std::vector<T> values);
+
+template <typename Op, typename Layout>
+void check_sum_batch(const std::vector<int> &values);
+
+template <typename Op, typename Layout>
+void check_update_batch(int n);
+
+template <typename Op, typename T>
+int count_static_mismatches(const std::vector<T> &values);
+
+template <typename Op, typename Layout>
+void check_parallel_build(int n);
+
+template <typename Op, typename Layout>
+void check_parallel_sum_batch(int n);
+
+template <typename Tree>
+void print_batch_time(Tree &seg, const std::vector<std::pair<int, int>> &ranges, const char *name);
+
+template <typename Op, typename Layout>
+void check_mapped(int n, const std::string &path);
+
+template <typename Op, typename Layout>
+void check_save_load(int n);
+
 /** Default Constructor.
  * 
  * Check if container size is 0.
@@ -107,6 +155,133 @@ TEST_CASE("Copy Constructor")
   CHECK(*(segmentTree3.rbegin()) == *(a.rbegin()));
 }
 
+/*
+ * Testing that copies share their buffers until one of them is modified.
+ */
+TEST_CASE("copy-on-write")
+{
+  SegmentTree<int> empty, emptyCopy(empty);
+  CHECK(emptyCopy.use_count() == 0);
+  emptyCopy.update(0, 1);
+  CHECK(emptyCopy.empty());
+
+  int a[] = {1, 2, 3, 4, 5};
+  SegmentTree<int> original(a, 5);
+  CHECK(original.use_count() == 1);
+  SegmentTree<int> copy(original), assigned;
+  assigned = original;
+  CHECK(original.use_count() == 3);
+  CHECK(copy.begin() == original.begin());
+
+  copy.update(0, 10);
+  CHECK(copy.use_count() == 1);
+  CHECK(original.use_count() == 2);
+  CHECK(copy.sum(0, 5) == 24);
+  CHECK(original.sum(0, 5) == 15);
+  CHECK(assigned.sum(0, 5) == 15);
+
+  std::pair<int, int> updates[] = {{7, 1}, {4, 0}};
+  original.update_batch(updates, 2);
+  CHECK(original.sum(0, 5) == 10);
+  CHECK(assigned.sum(0, 5) == 15);
+  CHECK(assigned.use_count() == 1);
+
+  // Repeated assignment releases the previous buffers.
+  for (int i = 0; i < 3; ++i)
+  {
+    assigned = copy;
+    assigned = original;
+  }
+  CHECK(copy.use_count() == 1);
+  CHECK(original.use_count() == 2);
+  assigned = assigned;
+  CHECK(original.use_count() == 2);
+
+  SegmentTree<int, Sum<int>, BottomUpLayout> compact(a, 5), compactCopy(compact);
+  compactCopy.update(4, 0);
+  CHECK(*compact.rbegin() == 5);
+  CHECK(*compactCopy.rbegin() == 0);
+
+  // Writing to a shared tree moves it to new buffers: iterators taken before the write
+  // still read the shared buffers, which now belong to the copy alone.
+  SegmentTree<int> shared(a, 5), sharing(shared);
+  SegmentTree<int>::iterator before = shared.begin();
+  shared.update(0, 100);
+  CHECK(shared.begin() != before);
+  CHECK(before == sharing.begin());
+  CHECK(*before == 1);
+  CHECK(*shared.begin() == 100);
+  // A tree that is not shared keeps its buffers, and its iterators, on update.
+  before = shared.begin();
+  shared.update(1, 200);
+  CHECK(shared.begin() == before);
+  CHECK(*(before + 1) == 200);
+}
+
+/*
+ * Tree counting its copy constructions, so that a move can be told from a copy: a copy
+ * shares the buffers and would leave them where they were too.
+ */
+struct CopyCountingTree : SegmentTree<int, Sum<int>, BottomUpLayout>
+{
+  static inline int copies = 0;
+  using SegmentTree::SegmentTree;
+  CopyCountingTree(const CopyCountingTree &x) : SegmentTree(x) { ++copies; }
+  CopyCountingTree(CopyCountingTree &&x) = default;
+  CopyCountingTree &operator=(const CopyCountingTree &x) = default;
+  CopyCountingTree &operator=(CopyCountingTree &&x) = default;
+};
+
+/*
+ * Testing that moving and swapping trees hands over the buffers without copying them.
+ */
+TEST_CASE("move and swap")
+{
+  CHECK(std::is_nothrow_move_constructible<SegmentTree<int>>::value);
+  CHECK(std::is_nothrow_move_assignable<SegmentTree<int>>::value);
+  CHECK(std::is_nothrow_move_constructible<st::pmr::SegmentTree<int>>::value);
+  CHECK(!std::is_nothrow_move_assignable<st::pmr::SegmentTree<int>>::value);
+  CHECK(std::is_nothrow_swappable<SegmentTree<int, Min<int>, BottomUpLayout>>::value);
+
+  int a[] = {1, 2, 3, 4, 5};
+  SegmentTree<int> original(a, 5);
+  SegmentTree<int>::iterator first = original.begin();
+  SegmentTree<int> moved(std::move(original));
+  CHECK(moved.begin() == first);
+  CHECK(moved.use_count() == 1);
+  CHECK(moved.sum(0, 5) == 15);
+  CHECK(original.empty());
+  CHECK(original.use_count() == 0);
+  CHECK(original.sum(0, 5) == 0);
+
+  SegmentTree<int> assigned(a, 2);
+  assigned = std::move(moved);
+  CHECK(assigned.begin() == first);
+  CHECK(moved.empty());
+  moved = SegmentTree<int>(a + 1, 3);
+  CHECK(moved.sum(0, 3) == 9);
+
+  swap(moved, assigned);
+  CHECK(moved.begin() == first);
+  CHECK(assigned.sum(0, 3) == 9);
+
+  // Growing a vector of trees moves them, as their move constructor is noexcept.
+  CopyCountingTree::copies = 0;
+  std::vector<CopyCountingTree> trees;
+  for (int i = 0; i < 40; ++i)
+  {
+    trees.push_back(CopyCountingTree(a, 1 + i % 5));
+  }
+  CHECK(CopyCountingTree::copies == 0);
+  for (int i = 0; i < 40; ++i)
+  {
+    CHECK(trees[i].use_count() == 1);
+    CHECK(trees[i].sum(0, trees[i].size()) == (1 + i % 5) * (2 + i % 5) / 2);
+  }
+  std::vector<CopyCountingTree> copied(trees);
+  CHECK(CopyCountingTree::copies == 40);
+}
+
 /** Iterators.
  * 
  * Check if iterators are functioning.
@@ -278,58 +453,2165 @@ TEST_CASE("update")
   CHECK(segmentTree1.sum(2, 4) == 13);
 }
 
-TEST_CASE("Time Complexity")
+/*
+ * Testing the read-only members through a const reference, from several threads at once.
+ */
+TEST_CASE("const members")
 {
-  long int size = 100000;
-  std::vector<long int> a(size);
-  for (long int i = 0; i < size; ++i)
+  std::vector<int> a(1000);
+  for (int i = 0; i < 1000; ++i)
+  {
+    a[i] = i / 3;
+  }
+  SegmentTree<int, Sum<int>, BottomUpLayout> tree(a.begin(), a.end());
+  const SegmentTree<int, Sum<int>, BottomUpLayout> &shared = tree;
+  CHECK(std::is_same<decltype(shared.begin()), SegmentTree<int, Sum<int>, BottomUpLayout>::const_iterator>::value);
+  CHECK(std::is_same<decltype(shared.rbegin()), SegmentTree<int, Sum<int>, BottomUpLayout>::const_reverse_iterator>::value);
+
+  std::vector<int> failures(4);
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t)
+  {
+    readers.emplace_back([&shared, &failures, t] {
+      for (int v = t; v < 333; v += 4)
+      {
+        failures[t] += shared.count(v) != 3;
+        failures[t] += shared.find(v) != shared.begin() + 3 * v;
+        failures[t] += shared.lower_bound(v) != shared.begin() + 3 * v;
+        failures[t] += shared.upper_bound(v) != shared.begin() + 3 * v + 3;
+        failures[t] += shared.equal_range(v).second != shared.upper_bound(v);
+        failures[t] += shared.sum(3 * v, 3 * v + 3) != 3 * v;
+      }
+      failures[t] += *shared.rbegin() != 333;
+      failures[t] += shared.find(1000) != shared.end();
+    });
+  }
+  for (std::thread &reader : readers)
+  {
+    reader.join();
+  }
+  CHECK(failures == std::vector<int>(4, 0));
+
+  const SegmentTree<int> empty;
+  CHECK(empty.begin() == empty.end());
+  CHECK(empty.lower_bound(1) == empty.end());
+  CHECK(empty.sum(0, 1) == 0);
+}
+
+/*
+ * Testing the bottom-up layout against the recursive layout.
+ */
+TEST_CASE("BottomUpLayout sum and update")
+{
+  int a[] = {};
+  SegmentTree<int, Sum<int>, BottomUpLayout> segmentTree1(a, 0);
+  CHECK(segmentTree1.sum(0, 1) == 0);
+
+  std::vector<int> b(13);
+  for (int i = 0; i < 13; ++i)
+  {
+    b[i] = i * 7 % 5 - 2;
+  }
+  SegmentTree<int, Sum<int>, RecursiveLayout> recursive(b.begin(), b.end());
+  SegmentTree<int, Sum<int>, BottomUpLayout> bottomUp(b.begin(), b.end());
+  for (int l = 0; l <= 13; ++l)
+    for (int r = l; r <= 13; ++r)
+      CHECK(bottomUp.sum(l, r) == recursive.sum(l, r));
+
+  for (int i = 0; i < 13; i += 3)
+  {
+    recursive.update(i, i * i);
+    bottomUp.update(i, i * i);
+  }
+  for (int l = 0; l <= 13; ++l)
+    for (int r = l; r <= 13; ++r)
+      CHECK(bottomUp.sum(l, r) == recursive.sum(l, r));
+  CHECK(*(bottomUp.begin() + 3) == 9);
+
+  // Updating to a value smaller than the index.
+  bottomUp.update(12, 1);
+  CHECK(bottomUp.sum(12, 13) == 1);
+}
+
+/*
+ * Testing the blocked B-ary layout against the recursive layout for sizes around
+ * the block boundaries.
+ */
+TEST_CASE("BlockedLayout sum and update")
+{
+  int sizes[] = {1, 3, 4, 5, 16, 17, 21, 70};
+  for (int n : sizes)
+  {
+    std::vector<int> a(n);
+    for (int i = 0; i < n; ++i)
+    {
+      a[i] = i * 7 % 5 - 2;
+    }
+    SegmentTree<int, Sum<int>, RecursiveLayout> recursive(a.begin(), a.end());
+    SegmentTree<int, Sum<int>, BlockedLayout<4>> blocked(a.begin(), a.end());
+    SegmentTree<int, Sum<int>, CacheLineLayout<int>> cacheLine(a.data(), n);
+    CHECK(blocked.size() == n);
+    for (int i = 0; i < n; i += 2)
+    {
+      recursive.update(i, i * i);
+      blocked.update(i, i * i);
+      cacheLine.update(i, i * i);
+    }
+    for (int l = 0; l <= n; ++l)
+      for (int r = l; r <= n; ++r)
+      {
+        CHECK(blocked.sum(l, r) == recursive.sum(l, r));
+        CHECK(cacheLine.sum(l, r) == recursive.sum(l, r));
+      }
+    CHECK(*blocked.rbegin() == *recursive.rbegin());
+  }
+  CHECK(CacheLineLayout<int>::fanout == 16);
+  CHECK(CacheLineLayout<long long>::fanout == 8);
+}
+
+/*
+ * Testing the provided operations on every layout against a linear fold.
+ */
+TEST_CASE("operations")
+{
+  std::vector<int> a(37);
+  for (int i = 0; i < 37; ++i)
+  {
+    a[i] = (i * 29 + 11) % 24 * 6 - 40;
+  }
+  check_operation<Sum<int>, RecursiveLayout>(a);
+  check_operation<Min<int>, RecursiveLayout>(a);
+  check_operation<Max<int>, BottomUpLayout>(a);
+  check_operation<Min<int>, BlockedLayout<4>>(a);
+  check_operation<BitAnd<int>, BottomUpLayout>(a);
+  check_operation<BitOr<int>, BlockedLayout<4>>(a);
+  check_operation<BitXor<int>, RecursiveLayout>(a);
+  check_operation<Gcd<int>, CacheLineLayout<int>>(a);
+  check_operation<Gcd<int>, BottomUpLayout>(a);
+
+  std::vector<float> b(a.begin(), a.end());
+  check_operation<Max<float>, CacheLineLayout<float>>(b);
+
+  SegmentTree<int, Min<int>> empty;
+  CHECK(empty.sum(0, 4) == std::numeric_limits<int>::max());
+
+  SegmentTree<int, Max<int>, BottomUpLayout> maxTree(a.begin(), a.end());
+  maxTree.update(20, 1000);
+  CHECK(maxTree.sum(0, 37) == 1000);
+  CHECK(maxTree.sum(0, 20) < 1000);
+}
+
+/*
+ * Testing that a user defined operation which is not commutative is applied in order.
+ */
+struct Concatenate
+{
+  static std::string identity() { return ""; }
+  static std::string combine(const std::string &a, const std::string &b) { return a + b; }
+};
+
+TEST_CASE("non-commutative operation")
+{
+  std::vector<std::string> a;
+  for (char c = 'a'; c <= 'm'; ++c)
+  {
+    a.push_back(std::string(1, c));
+  }
+  check_operation<Concatenate, RecursiveLayout>(a);
+  check_operation<Concatenate, BottomUpLayout>(a);
+  check_operation<Concatenate, BlockedLayout<3>>(a);
+}
+
+/*
+ * Testing the memory used by each layout.
+ *
+ * BottomUpLayout keeps the elements in its leaves, so it needs exactly 2n slots
+ * while RecursiveLayout needs 4n nodes plus a copy of the n elements.
+ */
+TEST_CASE("memory footprint")
+{
+  SegmentTree<long, Sum<long>, BottomUpLayout> empty;
+  CHECK(empty.memory_footprint() == 0);
+
+  std::vector<long> a(1000);
+  for (int i = 0; i < 1000; ++i)
   {
     a[i] = i;
   }
-  SegmentTree<long int> segmentTree1(a.begin(), a.end());
-  print_time(a, segmentTree1, 0, size);
-  print_time(a, segmentTree1, 0, size / 2);
-  print_time(a, segmentTree1, 0, size / 4);
-  print_time(a, segmentTree1, 0, size / 8);
-  print_time(a, segmentTree1, 0, size / 16);
-  print_time(a, segmentTree1, 0, size / 32);
-  print_time(a, segmentTree1, 0, size / 64);
-  print_time(a, segmentTree1, 0, size / 128);
-  print_time(a, segmentTree1, 1250, 3000);
-  print_time(a, segmentTree1, 1250, 1254);
+  SegmentTree<long, Sum<long>, RecursiveLayout> recursive(a.begin(), a.end());
+  SegmentTree<long, Sum<long>, BottomUpLayout> compact(a.begin(), a.end());
+  CHECK(recursive.memory_footprint() == 5 * 1000 * sizeof(long));
+  CHECK(compact.memory_footprint() == 2 * 1000 * sizeof(long));
+
+  SegmentTree<long, Sum<long>, BottomUpLayout> copy(compact);
+  CHECK(copy.memory_footprint() == compact.memory_footprint());
+
+  // Iterators read the leaves directly.
+  std::vector<long>::iterator v_first = a.begin();
+  for (SegmentTree<long, Sum<long>, BottomUpLayout>::iterator s_first = compact.begin(); s_first != compact.end(); ++s_first)
+  {
+    CHECK(*s_first == *v_first);
+    ++v_first;
+  }
+  CHECK(*compact.rbegin() == 999);
+  compact.update(999, -1);
+  CHECK(*compact.rbegin() == -1);
+  CHECK(compact.count(-1) == 1);
+  CHECK(compact.sum(0, 1000) == 999 * 1000 / 2 - 1000);
 }
 
+/*
+ * Allocator counting the bytes it has handed out and not taken back.
+ */
 template <typename T>
-void print_time(std::vector<T> &vect, SegmentTree<T> &seg, long int l, long int r)
+struct CountingAllocator
 {
-  auto t1 = std::chrono::high_resolution_clock::now();
+  typedef T value_type;
+  long *live;
+  explicit CountingAllocator(long *live) : live(live) {}
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U> &other) : live(other.live) {}
+  T *allocate(std::size_t n)
+  {
+    *live += n * sizeof(T);
+    return std::allocator<T>().allocate(n);
+  }
+  void deallocate(T *p, std::size_t n)
+  {
+    *live -= n * sizeof(T);
+    std::allocator<T>().deallocate(p, n);
+  }
+  bool operator==(const CountingAllocator &other) const { return live == other.live; }
+  bool operator!=(const CountingAllocator &other) const { return live != other.live; }
+};
 
-  T stSum = seg.sum(l, r);
+/*
+ * Testing that every array comes from the allocator of the tree and goes back to it,
+ * and that only trees with equal allocators share their buffers.
+ */
+TEST_CASE("allocators")
+{
+  long live = 0, otherLive = 0;
+  std::vector<std::string> words = {"a", "b", "c", "d", "e", "f", "g"};
+  {
+    typedef SegmentTree<std::string, Concatenate, RecursiveLayout, CountingAllocator<std::string>> Tree;
+    Tree tree(words.begin(), words.end(), CountingAllocator<std::string>(&live));
+    CHECK(live >= long(tree.memory_footprint()));
+    CHECK(tree.sum(1, 5) == "bcde");
+
+    CountingAllocator<std::string> otherAlloc(&otherLive);
+    Tree copy(tree), other(otherAlloc);
+    CHECK(copy.use_count() == 2);
+    other = tree;
+    CHECK(other.use_count() == 1);
+    CHECK(otherLive >= long(other.memory_footprint()));
+    other.update(0, "z");
+    CHECK(other.sum(0, 3) == "zbc");
+    CHECK(tree.sum(0, 3) == "abc");
+
+    other = std::move(copy);
+    CHECK(copy.empty());
+    CHECK(tree.use_count() == 1);
+    CHECK(other.sum(0, 7) == "abcdefg");
+  }
+  CHECK(live == 0);
+  CHECK(otherLive == 0);
+
+  char buffer[1 << 16];
+  std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+  std::vector<int> a(1000);
+  for (int i = 0; i < 1000; ++i)
+  {
+    a[i] = i;
+  }
+  st::pmr::SegmentTree<int, Sum<int>, BottomUpLayout> inArena(a.data(), 1000, &arena), sharing(&arena);
+  CHECK(inArena.get_allocator().resource() == &arena);
+  CHECK(inArena.sum(0, 1000) == 999 * 1000 / 2);
+  sharing = inArena;
+  CHECK(sharing.use_count() == 2);
+
+  // A copy constructed pmr tree uses the default resource, as pmr containers do.
+  st::pmr::SegmentTree<int, Sum<int>, BottomUpLayout> copied(inArena);
+  CHECK(copied.use_count() == 1);
+  CHECK(copied.get_allocator().resource() == std::pmr::get_default_resource());
+  CHECK(copied.sum(0, 1000) == inArena.sum(0, 1000));
+  st::pmr::SegmentTree<int> onHeap(a.begin(), a.end(), 2);
+  CHECK(onHeap.get_allocator().resource() == std::pmr::get_default_resource());
+}
+
+/*
+ * Testing that HugePageAllocator aligns small arrays to a cache line and large ones to a
+ * huge page, that it refuses counts whose size overflows, and that trees using it match
+ * trees using the default allocator.
+ */
+TEST_CASE("HugePageAllocator")
+{
+  HugePageAllocator<int> alloc;
+  for (std::size_t count : {1, 3, 100, 1 << 19, (1 << 19) + 1, 3 << 20})
+  {
+    int *array = alloc.allocate(count);
+    std::uintptr_t address = reinterpret_cast<std::uintptr_t>(array);
+    CHECK(address % HugePageAllocator<int>::cache_line_size == 0);
+    if (HugePageAllocator<int>::uses_huge_pages(count))
+      CHECK(address % HugePageAllocator<int>::huge_page_size == 0);
+    array[count - 1] = 2;
+    array[0] = 1;
+    CHECK(array[0] + array[count - 1] == (count == 1 ? 2 : 3));
+    alloc.deallocate(array, count);
+  }
+  CHECK(HugePageAllocator<int>::uses_huge_pages(1 << 19) == HugePageAllocator<char>::uses_huge_pages(1 << 21));
+  CHECK(!HugePageAllocator<int>::uses_huge_pages(100));
+  // A count whose size in bytes wraps around throws instead of returning a short array.
+  CHECK_THROWS_AS(alloc.allocate(std::size_t(-1) / sizeof(int) + 1), std::bad_array_new_length);
+
+  int size = 1 << 20;
+  std::vector<long> a(size);
+  for (int i = 0; i < size; ++i)
+  {
+    a[i] = i % 1000;
+  }
+  SegmentTree<long, Sum<long>, BottomUpLayout> plain(a.data(), size);
+  SegmentTree<long, Sum<long>, BottomUpLayout, HugePageAllocator<long>> huge(a.data(), size), copy(huge);
+  SegmentTree<long, Sum<long>, RecursiveLayout, HugePageAllocator<long>> recursive(a.begin(), a.end(), 2);
+  CHECK(copy.use_count() == 2);
+  huge.update(5, 1000);
+  plain.update(5, 1000);
+  for (int i = 0; i < 1000; ++i)
+  {
+    int l = (i * 7919L) % size, r = (i * 104729L) % size;
+    CHECK(huge.sum(std::min(l, r), std::max(l, r) + 1) == plain.sum(std::min(l, r), std::max(l, r) + 1));
+    CHECK(recursive.sum(std::min(l, r), std::max(l, r) + 1) == copy.sum(std::min(l, r), std::max(l, r) + 1));
+  }
+}
+
+/*
+ * Testing that a saved tree maps back with the same sums for every layout, that a
+ * writable mapping updates without changing the file, and that mismatched, truncated
+ * and damaged files are refused.
+ */
+TEST_CASE("MappedSegmentTree")
+{
+  std::string path = (std::filesystem::temp_directory_path() / "segment_tree_mapped_test.bin").string();
+  check_mapped<Sum<long>, RecursiveLayout>(1000, path);
+  check_mapped<Min<long>, BottomUpLayout>(1000, path);
+  check_mapped<Max<long>, CacheLineLayout<long>>(1000, path);
+  check_mapped<Sum<long>, BottomUpLayout>(1, path);
+  check_mapped<Sum<long>, BottomUpLayout>(0, path);
+
+  std::vector<int> a = {5, 3, 8, 1};
+  SegmentTree<int, Sum<int>, BottomUpLayout> tree(a.begin(), a.end());
+  REQUIRE(tree.save(path));
+  CHECK_THROWS_AS((MappedSegmentTree<int, Min<int>, BottomUpLayout>(path)), std::runtime_error);
+  CHECK_THROWS_AS((MappedSegmentTree<int, Sum<int>, RecursiveLayout>(path)), std::runtime_error);
+  CHECK_THROWS_AS((MappedSegmentTree<unsigned, Sum<unsigned>, BottomUpLayout>(path)), std::runtime_error);
+  CHECK_THROWS_AS((MappedSegmentTree<long, Sum<long>, BottomUpLayout>(path)), std::runtime_error);
+  CHECK_THROWS_AS((MappedSegmentTree<int, Sum<int>, BottomUpLayout>(path + ".missing")), std::runtime_error);
+
+  {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(sizeof(FileHeader) + 5 * sizeof(int));
+    int damaged = 9;
+    file.write(reinterpret_cast<const char *>(&damaged), sizeof(damaged));
+  }
+  MappedSegmentTree<int, Sum<int>, BottomUpLayout> damaged(path);
+  CHECK(!damaged.verify());
+
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+  CHECK_THROWS_AS((MappedSegmentTree<int, Sum<int>, BottomUpLayout>(path)), std::runtime_error);
+  std::remove(path.c_str());
+  CHECK(!SegmentTree<int>(a.begin(), a.end()).save("/nonexistent/directory/tree.bin"));
+
+  // Slots no layout writes are saved as zeros, not as whatever the heap held before.
+  std::vector<long> elements(1000);
+  for (int i = 0; i < 1000; ++i)
+    elements[i] = i + 1;
+  std::string files[2];
+  for (int i = 0; i < 2; ++i)
+  {
+    {
+      std::vector<unsigned char> garbage(40064, i ? 0xCD : 0xAB);
+      REQUIRE(garbage.back() != 0);
+    }
+    REQUIRE(SegmentTree<long>(elements.begin(), elements.end()).save(path));
+    std::ifstream file(path, std::ios::binary);
+    files[i].assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+  std::remove(path.c_str());
+  CHECK(files[0].size() == sizeof(FileHeader) + 5000 * sizeof(long));
+  CHECK(files[0] == files[1]);
+}
+
+/*
+ * Testing that load() restores what save() wrote for every layout, including trees
+ * saved with the other byte order, that equal trees save the same bytes before and after
+ * a round trip, and that other trees, newer versions, truncated streams and damaged nodes
+ * are refused without changing the tree.
+ */
+TEST_CASE("save and load")
+{
+  check_save_load<Sum<long>, RecursiveLayout>(1000);
+  check_save_load<Min<long>, BottomUpLayout>(1000);
+  check_save_load<Max<long>, CacheLineLayout<long>>(1000);
+  check_save_load<Sum<long>, RecursiveLayout>(1);
+  check_save_load<Sum<long>, BottomUpLayout>(0);
+
+  std::vector<int> a = {5, 3, 8, 1};
+  SegmentTree<int, Sum<int>, BottomUpLayout> tree(a.begin(), a.end());
+  std::stringstream saved;
+  REQUIRE(tree.save(saved));
+  std::string bytes = saved.str();
+
+  SegmentTree<int, Min<int>, BottomUpLayout> otherOp(a.begin(), a.end());
+  std::istringstream in(bytes);
+  CHECK(!otherOp.load(in));
+  CHECK(otherOp.sum(0, 4) == 1);
+  SegmentTree<long, Sum<long>, BottomUpLayout> otherType;
+  in.clear();
+  in.str(bytes);
+  CHECK(!otherType.load(in));
+
+  SegmentTree<int, Sum<int>, BottomUpLayout> loaded;
+  FileHeader header;
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  header.version = FileHeader::current_version + 1;
+  std::string newer = bytes;
+  std::memcpy(&newer[0], &header, sizeof(header));
+  in.clear();
+  in.str(newer);
+  CHECK(!loaded.load(in));
+
+  std::string damaged = bytes;
+  damaged[sizeof(FileHeader) + 5 * sizeof(int)] ^= 1;
+  in.clear();
+  in.str(damaged);
+  CHECK(!loaded.load(in));
+  in.clear();
+  in.str(bytes.substr(0, bytes.size() - 1));
+  CHECK(!loaded.load(in));
+  CHECK(loaded.empty());
+
+  // A header announcing far more elements than the stream holds fails before allocating.
+  FileHeader huge = detail::make_header<int, Sum<int>, BottomUpLayout>(std::numeric_limits<int>::max() / 4);
+  std::string oversized = bytes;
+  std::memcpy(&oversized[0], &huge, sizeof(huge));
+  in.clear();
+  in.str(oversized);
+  CHECK(!loaded.load(in));
+  CHECK(loaded.empty());
+
+  in.clear();
+  in.str(bytes);
+  CHECK(loaded.load(in));
+  CHECK(loaded.sum(0, 4) == 17);
+}
+
+/*
+ * Testing sum_batch against sum for every layout, including empty and invalid ranges.
+ */
+TEST_CASE("sum_batch")
+{
+  SegmentTree<int> empty;
+  std::pair<int, int> range(0, 3);
+  int result = -1;
+  empty.sum_batch(&range, 1, &result);
+  CHECK(result == 0);
+
+  std::vector<int> a(41);
+  for (int i = 0; i < 41; ++i)
+  {
+    a[i] = (i * 13 + 5) % 17 - 8;
+  }
+  check_sum_batch<Sum<int>, RecursiveLayout>(a);
+  check_sum_batch<Min<int>, RecursiveLayout>(a);
+  check_sum_batch<Sum<int>, BottomUpLayout>(a);
+  check_sum_batch<Max<int>, CacheLineLayout<int>>(a);
+}
+
+/*
+ * Testing update_batch against one update per element for every layout,
+ * with repeated and out of range indices.
+ */
+TEST_CASE("update_batch")
+{
+  SegmentTree<int> empty;
+  std::pair<int, int> update(0, 3);
+  empty.update_batch(&update, 1);
+  CHECK(empty.sum(0, 1) == 0);
+
+  int sizes[] = {1, 2, 3, 5, 7, 16, 45, 100};
+  for (int n : sizes)
+  {
+    check_update_batch<Sum<int>, RecursiveLayout>(n);
+    check_update_batch<Max<int>, RecursiveLayout>(n);
+    check_update_batch<Sum<int>, BottomUpLayout>(n);
+    check_update_batch<Min<int>, BottomUpLayout>(n);
+    check_update_batch<Sum<int>, BlockedLayout<4>>(n);
+    check_update_batch<Sum<int>, CacheLineLayout<int>>(n);
+  }
+}
+
+/*
+ * Testing that a tree built with several threads matches the serial build for every layout,
+ * with sizes below and above the size where the build is split between threads.
+ */
+TEST_CASE("parallel build")
+{
+  SegmentTree<int> empty((const int *)nullptr, 0, 4);
+  CHECK(empty.empty());
+  CHECK(empty.sum(0, 1) == 0);
+
+  int sizes[] = {1, 45, 70001, 262144};
+  for (int n : sizes)
+  {
+    check_parallel_build<Sum<long>, RecursiveLayout>(n);
+    check_parallel_build<Min<long>, RecursiveLayout>(n);
+    check_parallel_build<Sum<long>, BottomUpLayout>(n);
+    check_parallel_build<Max<long>, BottomUpLayout>(n);
+    check_parallel_build<Sum<long>, CacheLineLayout<long>>(n);
+    check_parallel_build<Min<long>, BlockedLayout<3>>(n);
+  }
+}
 
+/*
+ * Runtime of building a tree on one thread against all hardware threads.
+ */
+TEST_CASE("parallel build Time Complexity")
+{
+  int size = 1 << 22, threads = std::max(2u, std::thread::hardware_concurrency());
+  std::vector<long int> a(size);
+  for (int i = 0; i < size; ++i)
+  {
+    a[i] = i;
+  }
+  auto t1 = std::chrono::high_resolution_clock::now();
+  SegmentTree<long int, Sum<long int>, RecursiveLayout> serial(a.data(), size);
   auto t2 = std::chrono::high_resolution_clock::now();
-  auto stDuration = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+  SegmentTree<long int, Sum<long int>, RecursiveLayout> parallel(a.data(), size, threads);
+  auto t3 = std::chrono::high_resolution_clock::now();
+  CHECK(serial.sum(0, size) == parallel.sum(0, size));
 
-  t1 = std::chrono::high_resolution_clock::now();
+  std::cout << "\n\nMicroseconds taken to build a tree of " << size << " elements\n";
+  std::cout << "1 thread:\t" << std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() << "\n";
+  std::cout << threads << " threads:\t" << std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count() << "\n";
+}
 
-  long int init = 0;
-  T vectSum = accumulate(vect.begin() + l, vect.begin() + r, init);
+/*
+ * Testing parallel_sum_batch against sum_batch for every layout, with the shared pool,
+ * a pool of its own and two threads querying the same const tree at once.
+ */
+TEST_CASE("parallel_sum_batch")
+{
+  const SegmentTree<int> empty;
+  std::pair<int, int> range(0, 3);
+  int result = -1;
+  empty.parallel_sum_batch(&range, 1, &result, 4);
+  CHECK(result == 0);
 
-  t2 = std::chrono::high_resolution_clock::now();
-  auto vectDuration = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+  check_parallel_sum_batch<Sum<long>, RecursiveLayout>(100003);
+  check_parallel_sum_batch<Min<long>, BottomUpLayout>(100003);
+  check_parallel_sum_batch<Sum<long>, CacheLineLayout<long>>(100003);
+  check_parallel_sum_batch<Sum<long>, BottomUpLayout>(17);
+}
 
-  std::cout << "\n\nMicroseconds taken to find sum of an array in range[" << l << ", " << r << "]\n";
+/*
+ * Runtime of a batch of queries against calling sum once per query.
+ */
+TEST_CASE("sum_batch Time Complexity")
+{
+  int size = 100000, queries = 20000;
+  std::vector<long int> a(size);
+  for (int i = 0; i < size; ++i)
+  {
+    a[i] = i;
+  }
+  std::vector<std::pair<int, int>> ranges(queries);
+  for (int i = 0; i < queries; ++i)
+  {
+    int l = (i * 7919L) % size, r = (i * 104729L) % size;
+    ranges[i] = std::make_pair(std::min(l, r), std::max(l, r) + 1);
+  }
+  SegmentTree<long int, Sum<long int>, RecursiveLayout> recursive(a.begin(), a.end());
+  SegmentTree<long int, Sum<long int>, BottomUpLayout> bottomUp(a.begin(), a.end());
+  print_batch_time(recursive, ranges, "RecursiveLayout");
+  print_batch_time(bottomUp, ranges, "BottomUpLayout");
+  SegmentTree<long int, Sum<long int>, CacheLineLayout<long int>> blocked(a.begin(), a.end());
+  print_batch_time(blocked, ranges, "CacheLineLayout");
+}
 
-  std::cout << "Linear:\t" << vectDuration << "\t| Sum:\t" << vectSum << "\n";
-  std::cout << "S_tree:\t" << stDuration << "\t| Sum:\t" << stSum << "\n";
+/*
+ * Runtime of a large batch of queries as the number of threads grows.
+ */
+TEST_CASE("parallel_sum_batch Time Complexity")
+{
+  int size = 1 << 20, queries = 1 << 19;
+  std::vector<long int> a(size);
+  for (int i = 0; i < size; ++i)
+  {
+    a[i] = i;
+  }
+  std::vector<std::pair<int, int>> ranges(queries);
+  for (int i = 0; i < queries; ++i)
+  {
+    int l = (i * 7919L) % size, r = (i * 104729L) % size;
+    ranges[i] = std::make_pair(std::min(l, r), std::max(l, r) + 1);
+  }
+  const SegmentTree<long int, Sum<long int>, BottomUpLayout> seg(a.begin(), a.end());
+  std::vector<long int> expected(queries), results(queries);
+  seg.parallel_sum_batch(ranges.data(), queries, expected.data(), 1);
+
+  std::cout << "\n\nMicroseconds taken to find " << queries << " range sums with parallel_sum_batch\n";
+  int hardware = std::max(1u, std::thread::hardware_concurrency());
+  for (int threads = 1; threads <= 2 * hardware; threads *= 2)
+  {
+    auto t1 = std::chrono::high_resolution_clock::now();
+    seg.parallel_sum_batch(ranges.data(), queries, results.data(), threads);
+    auto t2 = std::chrono::high_resolution_clock::now();
+    CHECK(results == expected);
+    std::cout << threads << " threads:\t" << std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() << "\n";
+  }
 }
 
-template <typename T, typename ptr_t>
-T accumulate(ptr_t first, ptr_t last, T init)
+/*
+ * Runtime of building trees and querying them with global new against a reused arena.
+ *
+ * The arena buffer is already paged in, so the build pays no page faults.
+ */
+TEST_CASE("allocator Time Complexity")
 {
-  while (first != last)
+  int size = 1 << 21, rounds = 4, queries = 1 << 20;
+  std::vector<int> a(size);
+  for (int i = 0; i < size; ++i)
   {
-    init = init + *first;
-    ++first;
+    a[i] = i % 1000;
   }
-  return init;
+  std::vector<char> buffer(2 * size * sizeof(int) + 4096, 1);
+  std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size());
+
+  long long heapBuild = 0, arenaBuild = 0, heapQuery = 0, arenaQuery = 0, heapSum = 0, arenaSum = 0;
+  for (int round = 0; round < rounds; ++round)
+  {
+    auto t1 = std::chrono::high_resolution_clock::now();
+    SegmentTree<int, Sum<int>, BottomUpLayout> heap(a.data(), size);
+    auto t2 = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < queries; ++i)
+    {
+      int l = (i * 7919L) % size, r = (i * 104729L) % size;
+      heapSum += heap.sum(std::min(l, r), std::max(l, r) + 1);
+    }
+    auto t3 = std::chrono::high_resolution_clock::now();
+    heapBuild += std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+    heapQuery += std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count();
+  }
+  for (int round = 0; round < rounds; ++round)
+  {
+    {
+      auto t1 = std::chrono::high_resolution_clock::now();
+      st::pmr::SegmentTree<int, Sum<int>, BottomUpLayout> inArena(a.data(), size, &arena);
+      auto t2 = std::chrono::high_resolution_clock::now();
+      for (int i = 0; i < queries; ++i)
+      {
+        int l = (i * 7919L) % size, r = (i * 104729L) % size;
+        arenaSum += inArena.sum(std::min(l, r), std::max(l, r) + 1);
+      }
+      auto t3 = std::chrono::high_resolution_clock::now();
+      arenaBuild += std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+      arenaQuery += std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count();
+    }
+    arena.release();
+  }
+  CHECK(heapSum == arenaSum);
+
+  std::cout << "\n\nMicroseconds per build of " << size << " elements and per " << queries << " sums\n";
+  std::cout << "global new:\tbuild " << heapBuild / rounds << "\tsums " << heapQuery / rounds << "\n";
+  std::cout << "arena:\t\tbuild " << arenaBuild / rounds << "\tsums " << arenaQuery / rounds << "\n";
+}
+
+/*
+ * Runtime of random sums on a tree too large for the TLB with default and huge page storage.
+ */
+TEST_CASE("HugePageAllocator Time Complexity")
+{
+  int size = 1 << 23, queries = 1 << 20;
+  std::vector<long> a(size);
+  for (int i = 0; i < size; ++i)
+  {
+    a[i] = i % 1000;
+  }
+  long long plainSum = 0, hugeSum = 0;
+  SegmentTree<long, Sum<long>, BottomUpLayout> plain(a.data(), size);
+  auto t1 = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < queries; ++i)
+  {
+    int l = (i * 7919L) % size, r = (i * 104729L) % size;
+    plainSum += plain.sum(std::min(l, r), std::max(l, r) + 1);
+  }
+  auto t2 = std::chrono::high_resolution_clock::now();
+  plain = SegmentTree<long, Sum<long>, BottomUpLayout>();
+
+  SegmentTree<long, Sum<long>, BottomUpLayout, HugePageAllocator<long>> huge(a.data(), size);
+  auto t3 = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < queries; ++i)
+  {
+    int l = (i * 7919L) % size, r = (i * 104729L) % size;
+    hugeSum += huge.sum(std::min(l, r), std::max(l, r) + 1);
+  }
+  auto t4 = std::chrono::high_resolution_clock::now();
+  CHECK(plainSum == hugeSum);
+
+  std::cout << "\n\nMicroseconds for " << queries << " random sums over " << size << " elements\n";
+  std::cout << "default allocator:\t" << std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() << "\n";
+  std::cout << "HugePageAllocator:\t" << std::chrono::duration_cast<std::chrono::microseconds>(t4 - t3).count() << "\n";
+}
+
+/*
+ * Runtime of building a tree against mapping the same tree saved to a file.
+ */
+TEST_CASE("MappedSegmentTree Time Complexity")
+{
+  int size = 1 << 22, queries = 1 << 16;
+  std::string path = (std::filesystem::temp_directory_path() / "segment_tree_mapped_time.bin").string();
+  std::vector<int> a(size);
+  for (int i = 0; i < size; ++i)
+  {
+    a[i] = i % 1000;
+  }
+  auto t1 = std::chrono::high_resolution_clock::now();
+  SegmentTree<int, Sum<int>, BottomUpLayout> built(a.data(), size);
+  auto t2 = std::chrono::high_resolution_clock::now();
+  REQUIRE(built.save(path));
+  auto t3 = std::chrono::high_resolution_clock::now();
+  MappedSegmentTree<int, Sum<int>, BottomUpLayout> mapped(path);
+  long long builtSum = 0, mappedSum = 0;
+  for (int i = 0; i < queries; ++i)
+  {
+    int l = (i * 7919L) % size, r = (i * 104729L) % size;
+    mappedSum += mapped.sum(std::min(l, r), std::max(l, r) + 1);
+  }
+  auto t4 = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < queries; ++i)
+  {
+    int l = (i * 7919L) % size, r = (i * 104729L) % size;
+    builtSum += built.sum(std::min(l, r), std::max(l, r) + 1);
+  }
+  CHECK(builtSum == mappedSum);
+  std::remove(path.c_str());
+
+  std::cout << "\n\nMicroseconds to get a queryable tree of " << size << " elements\n";
+  std::cout << "build:\t\t\t" << std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() << "\n";
+  std::cout << "map and " << queries << " sums:\t" << std::chrono::duration_cast<std::chrono::microseconds>(t4 - t3).count() << "\n";
+}
+
+/*
+ * Runtime of building a tree from its elements against loading it from a saved stream.
+ */
+TEST_CASE("load Time Complexity")
+{
+  int size = 1 << 22;
+  std::vector<int> a(size);
+  for (int i = 0; i < size; ++i)
+  {
+    a[i] = i % 1000;
+  }
+  std::stringstream saved;
+  REQUIRE((SegmentTree<int, Sum<int>, BottomUpLayout>(a.data(), size).save(saved)));
+  SegmentTree<int, Sum<int>, RecursiveLayout> recursive(a.data(), size);
+  std::stringstream savedRecursive;
+  REQUIRE(recursive.save(savedRecursive));
+
+  auto t1 = std::chrono::high_resolution_clock::now();
+  SegmentTree<int, Sum<int>, BottomUpLayout> built(a.data(), size);
+  auto t2 = std::chrono::high_resolution_clock::now();
+  SegmentTree<int, Sum<int>, BottomUpLayout> loaded;
+  CHECK(loaded.load(saved));
+  auto t3 = std::chrono::high_resolution_clock::now();
+  SegmentTree<int, Sum<int>, RecursiveLayout> builtRecursive(a.data(), size);
+  auto t4 = std::chrono::high_resolution_clock::now();
+  SegmentTree<int, Sum<int>, RecursiveLayout> loadedRecursive;
+  CHECK(loadedRecursive.load(savedRecursive));
+  auto t5 = std::chrono::high_resolution_clock::now();
+  CHECK(loaded.sum(12, size - 5) == built.sum(12, size - 5));
+  CHECK(loadedRecursive.sum(12, size - 5) == builtRecursive.sum(12, size - 5));
+
+  std::cout << "\n\nMicroseconds to build and to load a tree of " << size << " elements\n";
+  std::cout << "BottomUpLayout:\tbuild " << std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count()
+            << "\tload " << std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count() << "\n";
+  std::cout << "RecursiveLayout:\tbuild " << std::chrono::duration_cast<std::chrono::microseconds>(t4 - t3).count()
+            << "\tload " << std::chrono::duration_cast<std::chrono::microseconds>(t5 - t4).count() << "\n";
+}
+
+/*
+ * Testing range updates with lazy propagation against a plain array.
+ *
+ * Check sums after mixed range_add, range_assign and update.
+ * Check that iterators see the values with the pending updates applied.
+ */
+TEST_CASE("LazySegmentTree range updates")
+{
+  LazySegmentTree<long> empty;
+  CHECK(empty.sum(0, 3) == 0);
+  empty.range_add(0, 3, 5);
+  CHECK(empty.begin() == empty.end());
+
+  std::vector<long> a(23);
+  for (int i = 0; i < 23; ++i)
+  {
+    a[i] = i * 3 % 7;
+  }
+  LazySegmentTree<long> lazy(a.begin(), a.end());
+  for (int step = 0; step < 60; ++step)
+  {
+    int l = step * 7 % 23, r = l + step * 5 % (24 - l);
+    long value = step % 9 - 4;
+    if (step % 3 == 0)
+    {
+      lazy.range_add(l, r, value);
+      for (int i = l; i < r; ++i)
+        a[i] += value;
+    }
+    else if (step % 3 == 1)
+    {
+      lazy.range_assign(l, r, value);
+      for (int i = l; i < r; ++i)
+        a[i] = value;
+    }
+    else
+    {
+      lazy.update(l % 23, value * 10);
+      a[l % 23] = value * 10;
+    }
+    for (int ql = 0; ql <= 23; ql += 4)
+      for (int qr = ql; qr <= 23; qr += 3)
+        CHECK(lazy.sum(ql, qr) == ::accumulate(a.begin() + ql, a.begin() + qr, 0L));
+    if (step % 10 == 0)
+    {
+      std::vector<long>::iterator v_first = a.begin();
+      for (LazySegmentTree<long>::iterator s_first = lazy.begin(); s_first != lazy.end(); ++s_first)
+      {
+        CHECK(*s_first == *v_first);
+        ++v_first;
+      }
+    }
+  }
+
+  LazySegmentTree<long> copy(lazy);
+  lazy.range_assign(0, 23, 1);
+  CHECK(lazy.sum(0, 23) == 23);
+  CHECK(lazy.count(1) == 23);
+  CHECK(copy.sum(0, 23) == ::accumulate(a.begin(), a.end(), 0L));
+  CHECK(*copy.rbegin() == a[22]);
+  copy = lazy;
+  CHECK(copy.find(1) == copy.begin());
+
+  // Iterators taken before a range update read the values after it.
+  LazySegmentTree<long>::iterator first = lazy.begin(), third = lazy.begin() + 2;
+  LazySegmentTree<long>::reverse_iterator last = lazy.rbegin();
+  lazy.range_add(0, 3, 4);
+  lazy.range_assign(20, 23, 9);
+  CHECK(*first == 5);
+  CHECK(*third == 5);
+  CHECK(*(third + 1) == 1);
+  CHECK(*last == 9);
+  CHECK(lazy.at(21) == 9);
+  CHECK(lazy.count(5) == 3);
+  CHECK(lazy.find(9) == lazy.begin() + 20);
+  CHECK(lazy.find(7) == lazy.end());
+}
+
+/*
+ * Testing ConcurrentSegmentTree against SegmentTree on one thread.
+ */
+TEST_CASE("ConcurrentSegmentTree sum and update")
+{
+  ConcurrentSegmentTree<int> empty;
+  CHECK(empty.sum(0, 3) == 0);
+  empty.update(0, 1);
+  CHECK(empty.version() == 0);
+
+  std::vector<int> a(37);
+  for (int i = 0; i < 37; ++i)
+  {
+    a[i] = i * 7 % 11 - 5;
+  }
+  ConcurrentSegmentTree<int, Max<int>> concurrent(a.begin(), a.end());
+  SegmentTree<int, Max<int>, BottomUpLayout> plain(a.data(), 37);
+  for (int i = 0; i < 37; i += 4)
+  {
+    concurrent.update(i, i * 3 - 20);
+    plain.update(i, i * 3 - 20);
+  }
+  std::pair<int, int> updates[] = {{3, 40}, {36, -9}, {37, 100}, {3, 2}};
+  concurrent.update_batch(updates, 4);
+  plain.update_batch(updates, 4);
+  CHECK(concurrent.version() == 2 * 11);
+  for (int l = 0; l <= 37; ++l)
+    for (int r = l; r <= 37; ++r)
+      CHECK(concurrent.sum(l, r) == plain.sum(l, r));
+}
+
+/*
+ * Stress test of one writer and several readers.
+ *
+ * The writer moves amounts between the two elements of a pair in one update_batch, so the
+ * sum of every pair and of the whole tree never changes. Readers must never see another sum.
+ */
+TEST_CASE("ConcurrentSegmentTree readers during writes")
+{
+  int n = 1001, pairs = n / 2;
+  std::vector<long> a(n);
+  for (int i = 0; i < n; ++i)
+  {
+    a[i] = i % 17;
+  }
+  long total = ::accumulate(a.begin(), a.end(), 0L);
+  ConcurrentSegmentTree<long> tree(a.begin(), a.end());
+
+  std::atomic<bool> done(false);
+  std::vector<long> failures(4), reads(4);
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t)
+  {
+    readers.emplace_back([&, t] {
+      for (int k = t; !done.load() || reads[t] < 1000; ++k)
+      {
+        int pair = k * 7919L % pairs;
+        failures[t] += tree.sum(0, n) != total;
+        failures[t] += tree.sum(2 * pair, 2 * pair + 2) != a[2 * pair] + a[2 * pair + 1];
+        ++reads[t];
+      }
+    });
+  }
+  std::vector<long> leaves(a);
+  for (int step = 0; step < 200000; ++step)
+  {
+    int pair = step * 104729L % pairs, amount = step % 13 - 6;
+    leaves[2 * pair] -= amount;
+    leaves[2 * pair + 1] += amount;
+    std::pair<int, long> transfer[] = {{2 * pair, leaves[2 * pair]}, {2 * pair + 1, leaves[2 * pair + 1]}};
+    tree.update_batch(transfer, 2);
+  }
+  done.store(true);
+  for (std::thread &reader : readers)
+  {
+    reader.join();
+  }
+  CHECK(failures == std::vector<long>(4, 0));
+  CHECK(tree.sum(0, n) == total);
+  CHECK(tree.version() == 2 * 200000);
+}
+
+/*
+ * Testing every version of a PersistentSegmentTree against a copy of the elements kept per version.
+ *
+ * Check that each update adds no more than one node per level.
+ */
+TEST_CASE("PersistentSegmentTree versions")
+{
+  PersistentSegmentTree<int> empty;
+  CHECK(empty.sum(0, 0, 2) == 0);
+  CHECK(empty.update(0, 1) == -1);
+  CHECK(empty.versions() == 1);
+
+  int n = 1000;
+  std::vector<std::vector<int>> history(1, std::vector<int>(n));
+  for (int i = 0; i < n; ++i)
+  {
+    history[0][i] = i % 10;
+  }
+  PersistentSegmentTree<int> tree(history[0].begin(), history[0].end());
+  std::size_t built = tree.memory_footprint();
+  for (int step = 1; step <= 300; ++step)
+  {
+    // Every third version branches from an older one.
+    int from = step % 3 == 0 ? step / 2 : step - 1, index = step * 7919 % n;
+    history.push_back(history[from]);
+    history.back()[index] = step;
+    CHECK(tree.update(from, index, step) == step);
+  }
+  CHECK(tree.versions() == 301);
+  CHECK(tree.memory_footprint() - built <= 300 * (11 * (sizeof(int) * 3) + sizeof(int)));
+  CHECK(tree.update(301, 0, 1) == -1);
+  CHECK(tree.update(0, n, 1) == -1);
+
+  int mismatches = 0;
+  for (int version = 0; version <= 300; ++version)
+  {
+    for (int l = 0; l < n; l += 37)
+      for (int r = l; r <= n; r += 91)
+        mismatches += tree.sum(version, l, r) != ::accumulate(history[version].begin() + l, history[version].begin() + r, 0);
+  }
+  CHECK(mismatches == 0);
+  CHECK(tree.sum(0, n) == ::accumulate(history.back().begin(), history.back().end(), 0));
+
+  PersistentSegmentTree<int, Min<int>> minimums(history[0].data(), n);
+  CHECK(minimums.sum(0, n) == 0);
+  for (int i = 0; i < n; i += 10)
+    minimums.update(i, 5);
+  CHECK(minimums.sum(0, n) == 1);
+  CHECK(minimums.sum(0, 0, n) == 0);
+}
+
+/*
+ * Testing push_back, append and reserve against a vector of the same elements.
+ *
+ * Check sums after every growth of the capacity, in order for a non-commutative operation.
+ */
+TEST_CASE("GrowableSegmentTree push_back and append")
+{
+  GrowableSegmentTree<long> tree;
+  std::vector<long> a;
+  CHECK(tree.empty());
+  CHECK(tree.capacity() == 0);
+  CHECK(tree.sum(0, 5) == 0);
+  int mismatches = 0;
+  for (int i = 0; i < 300; ++i)
+  {
+    long value = (i * 7919L) % 100 - 50;
+    if (i % 3 == 0)
+    {
+      tree.push_back(value);
+      a.push_back(value);
+    }
+    else
+    {
+      std::vector<long> chunk(i % 7, value);
+      tree.append(chunk.begin(), chunk.end());
+      a.insert(a.end(), chunk.begin(), chunk.end());
+    }
+    for (int l = 0; l <= int(a.size()); l += 5)
+    {
+      for (int r = l; r <= int(a.size()); r += 3)
+      {
+        if (tree.sum(l, r) != std::accumulate(a.begin() + l, a.begin() + r, 0L))
+          ++mismatches;
+      }
+    }
+  }
+  CHECK(mismatches == 0);
+  CHECK(tree.size() == int(a.size()));
+  CHECK(tree.capacity() >= tree.size());
+  CHECK(tree.capacity() < 2 * tree.size());
+  int i = 0;
+  for (auto it = tree.begin(); it != tree.end(); ++it, ++i)
+  {
+    if (*it != a[i])
+      ++mismatches;
+  }
+  CHECK(mismatches == 0);
+
+  tree.update(3, 1000);
+  a[3] = 1000;
+  CHECK(tree.sum(0, tree.size()) == std::accumulate(a.begin(), a.end(), 0L));
+  tree.reserve(5000);
+  CHECK(tree.capacity() == 8192);
+  CHECK(tree.sum(0, tree.size()) == std::accumulate(a.begin(), a.end(), 0L));
+  CHECK(tree.sum(2, 9) == std::accumulate(a.begin() + 2, a.begin() + 9, 0L));
+
+  std::vector<std::string> words = {"a", "b", "c"};
+  GrowableSegmentTree<std::string, Concatenate> text(words.begin(), words.end());
+  text.push_back("d");
+  text.push_back("e");
+  words = {"f", "g", "h", "i"};
+  text.append(words.begin(), words.end());
+  CHECK(text.sum(0, text.size()) == "abcdefghi");
+  CHECK(text.sum(2, 7) == "cdefg");
+  GrowableSegmentTree<int, Min<int>> minimums;
+  minimums.push_back(4);
+  CHECK(minimums.sum(0, 8) == 4);
+}
+
+/*
+ * Runtime of adding a day of elements to a growing tree against rebuilding the tree.
+ */
+TEST_CASE("GrowableSegmentTree Time Complexity")
+{
+  int days = 64, perDay = 1 << 15;
+  std::vector<int> day(perDay), all;
+  for (int i = 0; i < perDay; ++i)
+  {
+    day[i] = i % 1000;
+  }
+  GrowableSegmentTree<int> growing;
+  long long appendTime = 0, pushTime = 0, rebuildTime = 0;
+  for (int d = 0; d < days; ++d)
+  {
+    auto t1 = std::chrono::high_resolution_clock::now();
+    growing.append(day.begin(), day.end());
+    auto t2 = std::chrono::high_resolution_clock::now();
+    all.insert(all.end(), day.begin(), day.end());
+    auto t3 = std::chrono::high_resolution_clock::now();
+    SegmentTree<int, Sum<int>, BottomUpLayout> rebuilt(all.data(), all.size());
+    auto t4 = std::chrono::high_resolution_clock::now();
+    CHECK(rebuilt.sum(0, all.size()) == growing.sum(0, growing.size()));
+    appendTime += std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+    rebuildTime += std::chrono::duration_cast<std::chrono::microseconds>(t4 - t3).count();
+  }
+  GrowableSegmentTree<int> pushed;
+  auto t1 = std::chrono::high_resolution_clock::now();
+  for (int value : all)
+  {
+    pushed.push_back(value);
+  }
+  auto t2 = std::chrono::high_resolution_clock::now();
+  pushTime = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+  CHECK(pushed.sum(0, pushed.size()) == growing.sum(0, growing.size()));
+
+  std::cout << "\n\nMicroseconds to grow a tree to " << days << " days of " << perDay << " elements\n";
+  std::cout << "append per day:\t\t" << appendTime << "\n";
+  std::cout << "push_back each:\t\t" << pushTime << "\n";
+  std::cout << "rebuild per day:\t" << rebuildTime << "\n";
+}
+
+/*
+ * Testing a sliding window against the tail of a vector of everything pushed.
+ *
+ * Check every logical range before and after the window wraps around, in order
+ * for a non-commutative operation.
+ */
+TEST_CASE("WindowSegmentTree push and window_sum")
+{
+  int capacity = 13;
+  WindowSegmentTree<long> window(capacity);
+  std::vector<long> pushed;
+  CHECK(window.empty());
+  CHECK(window.window_sum(5) == 0);
+  int mismatches = 0;
+  for (int i = 0; i < 60; ++i)
+  {
+    long value = (i * 7919L) % 100 - 50;
+    window.push(value);
+    pushed.push_back(value);
+    int n = std::min<int>(pushed.size(), capacity);
+    std::vector<long>::iterator oldest = pushed.end() - n;
+    if (window.size() != n)
+      ++mismatches;
+    for (int k = 0; k <= n + 2; ++k)
+    {
+      if (window.window_sum(k) != std::accumulate(pushed.end() - std::min(k, n), pushed.end(), 0L))
+        ++mismatches;
+    }
+    for (int l = 0; l <= n; ++l)
+    {
+      for (int r = l; r <= n; ++r)
+      {
+        if (window.sum(l, r) != std::accumulate(oldest + l, oldest + r, 0L))
+          ++mismatches;
+      }
+      if (l < n && window[l] != oldest[l])
+        ++mismatches;
+    }
+  }
+  CHECK(mismatches == 0);
+  CHECK(window.size() == capacity);
+  CHECK(window.capacity() == capacity);
+
+  WindowSegmentTree<std::string, Concatenate> text(4);
+  for (std::string word : {"a", "b", "c", "d", "e", "f"})
+  {
+    text.push(word);
+  }
+  CHECK(text.sum(0, 4) == "cdef");
+  CHECK(text.window_sum(3) == "def");
+  CHECK(text.sum(1, 3) == "de");
+  WindowSegmentTree<int, Max<int>> none(0);
+  none.push(3);
+  CHECK(none.empty());
+  CHECK(none.window_sum(1) == std::numeric_limits<int>::lowest());
+}
+
+/*
+ * Runtime of keeping rolling sums with a sliding window against rebuilding a tree of the
+ * window, with sums at most rebuildEvery elements stale.
+ */
+TEST_CASE("WindowSegmentTree Time Complexity")
+{
+  int capacity = 1 << 16, pushes = 1 << 20, rebuildEvery = 1 << 8;
+  std::vector<int> stream(pushes);
+  for (int i = 0; i < pushes; ++i)
+  {
+    stream[i] = i % 1000;
+  }
+  WindowSegmentTree<int> window(capacity);
+  long long windowSum = 0, rebuiltSum = 0;
+  auto t1 = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < pushes; ++i)
+  {
+    window.push(stream[i]);
+    if ((i + 1) % rebuildEvery == 0)
+      windowSum += window.window_sum(capacity / 2);
+  }
+  auto t2 = std::chrono::high_resolution_clock::now();
+  for (int i = rebuildEvery - 1; i < pushes; i += rebuildEvery)
+  {
+    int first = std::max(0, i + 1 - capacity);
+    SegmentTree<int, Sum<int>, BottomUpLayout> rebuilt(stream.data() + first, i + 1 - first);
+    rebuiltSum += rebuilt.sum(std::max(0, rebuilt.size() - capacity / 2), rebuilt.size());
+  }
+  auto t3 = std::chrono::high_resolution_clock::now();
+  CHECK(windowSum == rebuiltSum);
+
+  std::cout << "\n\nMicroseconds to follow a window of " << capacity << " over " << pushes << " elements\n";
+  std::cout << "push each:\t\t" << std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() << "\n";
+  std::cout << "rebuild every " << rebuildEvery << ":\t" << std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count() << "\n";
+}
+
+/*
+ * Testing a sparse tree over a range of 2^62 against a map of the updated indices.
+ *
+ * Check that nodes are only created on the paths of updated elements.
+ */
+TEST_CASE("SparseSegmentTree")
+{
+  long long size = 1LL << 62;
+  SparseSegmentTree<long> tree(size);
+  std::map<long long, long> values;
+  CHECK(tree.sum(0, size) == 0);
+  CHECK(tree.node_count() == 2);
+  for (int i = 0; i < 2000; ++i)
+  {
+    long long index = (i % 10 == 0) ? size - 1 - i : (long long)((i * 0x9E3779B97F4A7C15ull) >> 2);
+    long value = (i * 7919L) % 100 - 50;
+    tree.update(index, value);
+    values[index] = value;
+  }
+  tree.update(-1, 5);
+  tree.update(size, 5);
+  CHECK(tree.node_count() <= 2 + 2000 * 62);
+
+  int mismatches = 0;
+  std::vector<long long> bounds = {0, 1, size / 3, size / 2, size - 10, size - 1, size};
+  for (const std::pair<const long long, long> &entry : values)
+  {
+    if (bounds.size() < 200)
+      bounds.push_back(entry.first + (bounds.size() % 2));
+  }
+  for (long long l : bounds)
+  {
+    for (long long r : bounds)
+    {
+      long expected = 0;
+      for (auto it = values.lower_bound(l); it != values.end() && it->first < r; ++it)
+      {
+        expected += it->second;
+      }
+      if (tree.sum(l, r) != expected)
+        ++mismatches;
+    }
+  }
+  CHECK(mismatches == 0);
+  CHECK(tree.sum(-5, size + 5) == tree.sum(0, size));
+
+  SparseSegmentTree<std::string, Concatenate> text(1000000000000LL);
+  text.update(999999999999LL, "c");
+  text.update(0, "a");
+  text.update(123456789, "b");
+  CHECK(text.sum(0, text.size()) == "abc");
+  CHECK(text.sum(1, text.size()) == "bc");
+  SparseSegmentTree<int, Min<int>> minimums(10);
+  minimums.update(4, -3);
+  CHECK(minimums.sum(0, 4) == std::numeric_limits<int>::max());
+  CHECK(minimums.sum(0, 10) == -3);
+}
+
+/*
+ * Runtime and memory of updates and sums spread over a range of 2^62.
+ */
+TEST_CASE("SparseSegmentTree Time Complexity")
+{
+  int updates = 1 << 18;
+  long long size = 1LL << 62;
+  SparseSegmentTree<long> tree(size);
+  auto t1 = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < updates; ++i)
+  {
+    tree.update((long long)((i * 0x9E3779B97F4A7C15ull) >> 2), i % 1000);
+  }
+  auto t2 = std::chrono::high_resolution_clock::now();
+  long long total = 0;
+  for (int i = 0; i < updates; ++i)
+  {
+    long long l = (long long)((i * 0xC2B2AE3D27D4EB4Full) >> 2), r = (long long)((i * 0x165667B19E3779F9ull) >> 2);
+    total += tree.sum(std::min(l, r), std::max(l, r));
+  }
+  auto t3 = std::chrono::high_resolution_clock::now();
+  CHECK(tree.sum(0, size) == (long long)(updates / 1000) * 999 * 1000 / 2 + (long long)(updates % 1000) * (updates % 1000 - 1) / 2);
+  CHECK(total > 0);
+
+  std::cout << "\n\nMicroseconds for " << updates << " updates and sums over a range of 2^62\n";
+  std::cout << "updates:\t" << std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() << "\n";
+  std::cout << "sums:\t\t" << std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count() << "\n";
+  std::cout << "nodes:\t\t" << tree.node_count() << " (" << tree.memory_footprint() / (1 << 20) << " MiB)\n";
+}
+
+/*
+ * Testing key lookups and key range sums against std::lower_bound on the sorted keys.
+ *
+ * Check every size up to 40, so that each shape of the last level is searched.
+ */
+TEST_CASE("KeyedSegmentTree")
+{
+  int mismatches = 0;
+  for (int n = 0; n <= 40; ++n)
+  {
+    std::vector<long long> keys(n);
+    std::vector<int> values(n);
+    for (int i = 0; i < n; ++i)
+    {
+      keys[i] = 10LL * i * i - 50;
+      values[i] = i + 1;
+    }
+    KeyedSegmentTree<long long, int> tree(keys.data(), values.data(), n);
+    if (tree.size() != n)
+      ++mismatches;
+    for (long long key = -60; key <= 10LL * n * n; key += 3)
+    {
+      int expected = std::lower_bound(keys.begin(), keys.end(), key) - keys.begin();
+      if (tree.lower_bound_index(key) != expected)
+        ++mismatches;
+      if (tree.sum_keys(-1000, key) != expected * (expected + 1) / 2)
+        ++mismatches;
+    }
+  }
+  CHECK(mismatches == 0);
+
+  std::vector<std::pair<std::string, long>> prices = {{"apple", 3}, {"banana", 5}, {"cherry", 7}, {"date", 11}};
+  KeyedSegmentTree<std::string, long, Max<long>> maximums(prices.begin(), prices.end());
+  CHECK(maximums.sum_keys("b", "d") == 7);
+  CHECK(maximums.sum_keys("a", "z") == 11);
+  CHECK(maximums.sum_keys("e", "z") == std::numeric_limits<long>::lowest());
+  CHECK(maximums.update_key("banana", 20));
+  CHECK(!maximums.update_key("blueberry", 30));
+  CHECK(!maximums.update_key("zucchini", 30));
+  CHECK(maximums.sum_keys("b", "d") == 20);
+  CHECK(maximums.sum_keys("c", "d") == 7);
+
+  KeyedSegmentTree<int, int> empty;
+  CHECK(empty.empty());
+  CHECK(empty.sum_keys(0, 10) == 0);
+  CHECK(!empty.update_key(0, 1));
+}
+
+/*
+ * Runtime of key range sums with the Eytzinger search against std::lower_bound, next to
+ * the runtime of the index range sums alone.
+ */
+TEST_CASE("KeyedSegmentTree Time Complexity")
+{
+  int size = 1 << 22, queries = 1 << 20;
+  std::vector<long long> keys(size), probes(2 * queries);
+  std::vector<int> values(size);
+  for (int i = 0; i < size; ++i)
+  {
+    keys[i] = 1600000000000LL + 37LL * i;
+    values[i] = i % 1000;
+  }
+  for (int i = 0; i < 2 * queries; ++i)
+  {
+    probes[i] = keys[(i * 7919L) % size] + i % 37;
+  }
+  KeyedSegmentTree<long long, int> keyed(keys.data(), values.data(), size);
+  SegmentTree<int, Sum<int>, BottomUpLayout> tree(values.data(), size);
+
+  std::vector<std::pair<int, int>> ranges(queries);
+  for (int i = 0; i < queries; ++i)
+  {
+    ranges[i] = {keyed.lower_bound_index(std::min(probes[2 * i], probes[2 * i + 1])),
+                 keyed.lower_bound_index(std::max(probes[2 * i], probes[2 * i + 1]))};
+  }
+  long long keyedSum = 0, searchedSum = 0, indexSum = 0;
+  auto t1 = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < queries; ++i)
+  {
+    keyedSum += keyed.sum_keys(std::min(probes[2 * i], probes[2 * i + 1]), std::max(probes[2 * i], probes[2 * i + 1]));
+  }
+  auto t2 = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < queries; ++i)
+  {
+    int l = std::lower_bound(keys.begin(), keys.end(), std::min(probes[2 * i], probes[2 * i + 1])) - keys.begin();
+    int r = std::lower_bound(keys.begin(), keys.end(), std::max(probes[2 * i], probes[2 * i + 1])) - keys.begin();
+    searchedSum += tree.sum(l, r);
+  }
+  auto t3 = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < queries; ++i)
+  {
+    indexSum += tree.sum(ranges[i].first, ranges[i].second);
+  }
+  auto t4 = std::chrono::high_resolution_clock::now();
+  CHECK(keyedSum == searchedSum);
+  CHECK(keyedSum == indexSum);
+
+  std::cout << "\n\nMicroseconds for " << queries << " range sums over " << size << " keys\n";
+  std::cout << "sum_keys:\t\t\t" << std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() << "\n";
+  std::cout << "std::lower_bound and sum:\t" << std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count() << "\n";
+  std::cout << "sum by index only:\t\t" << std::chrono::duration_cast<std::chrono::microseconds>(t4 - t3).count() << "\n";
+}
+
+/*
+ * Testing rectangle sums and point updates against sums over the matrix itself.
+ *
+ * Check every shape up to 9 x 9, so that rows and columns of odd and even counts are covered.
+ */
+TEST_CASE("SegmentTree2D")
+{
+  int mismatches = 0;
+  for (int rows = 0; rows <= 9; ++rows)
+  {
+    for (int cols = 0; cols <= 9; ++cols)
+    {
+      std::vector<int> matrix(rows * cols);
+      for (int i = 0; i < rows * cols; ++i)
+      {
+        matrix[i] = (i * 37) % 23 - 11;
+      }
+      SegmentTree2D<int> sums(matrix.data(), rows, cols);
+      SegmentTree2D<int, Min<int>> minimums(matrix.data(), rows, cols);
+      for (int step = 0; step < 3; ++step)
+      {
+        for (int r1 = 0; r1 <= rows; ++r1)
+          for (int r2 = r1; r2 <= rows; ++r2)
+            for (int c1 = 0; c1 <= cols; ++c1)
+              for (int c2 = c1; c2 <= cols; ++c2)
+              {
+                int expectedSum = 0, expectedMin = std::numeric_limits<int>::max();
+                for (int r = r1; r < r2; ++r)
+                  for (int c = c1; c < c2; ++c)
+                  {
+                    expectedSum += matrix[r * cols + c];
+                    expectedMin = std::min(expectedMin, matrix[r * cols + c]);
+                  }
+                if (sums.sum(r1, c1, r2, c2) != expectedSum || minimums.sum(r1, c1, r2, c2) != expectedMin)
+                  ++mismatches;
+              }
+        if (rows * cols == 0)
+          break;
+        int r = (step * 5) % rows, c = (step * 7) % cols, val = 100 * (step + 1) - 250;
+        matrix[r * cols + c] = val;
+        sums.update(r, c, val);
+        minimums.update(r, c, val);
+        if (sums(r, c) != val)
+          ++mismatches;
+      }
+    }
+  }
+  CHECK(mismatches == 0);
+
+  SegmentTree2D<long> zeros(3, 4);
+  CHECK(zeros.rows() == 3);
+  CHECK(zeros.columns() == 4);
+  CHECK(zeros.memory_footprint() == 4 * 3 * 4 * sizeof(long));
+  zeros.update(2, 3, 5);
+  zeros.update(3, 0, 7);
+  CHECK(zeros.sum(-1, -1, 10, 10) == 5);
+  CHECK(zeros.sum(0, 0, 2, 4) == 0);
+
+  SegmentTree2D<int> empty;
+  CHECK(empty.empty());
+  CHECK(empty.sum(0, 0, 1, 1) == 0);
+}
+
+/*
+ * Runtime of rectangle sums with SegmentTree2D against one SegmentTree sum per row of the
+ * rectangle, as for a merchant by day matrix.
+ */
+TEST_CASE("SegmentTree2D Time Complexity")
+{
+  int rows = 1 << 10, cols = 1 << 10, queries = 1 << 16;
+  std::vector<long> matrix(std::size_t(rows) * cols);
+  for (std::size_t i = 0; i < matrix.size(); ++i)
+  {
+    matrix[i] = i % 1000;
+  }
+  SegmentTree2D<long> grid(matrix.data(), rows, cols);
+  std::vector<SegmentTree<long>> perRow;
+  for (int r = 0; r < rows; ++r)
+  {
+    perRow.emplace_back(matrix.data() + std::size_t(r) * cols, cols);
+  }
+  std::vector<int> bounds(4 * queries);
+  for (int i = 0; i < queries; ++i)
+  {
+    int r1 = (i * 7919L) % rows, r2 = (i * 104729L) % rows;
+    int c1 = (i * 15485863L) % cols, c2 = (i * 2750159L) % cols;
+    bounds[4 * i] = std::min(r1, r2);
+    bounds[4 * i + 1] = std::min(c1, c2);
+    bounds[4 * i + 2] = std::max(r1, r2) + 1;
+    bounds[4 * i + 3] = std::max(c1, c2) + 1;
+  }
+
+  long gridSum = 0, rowSum = 0;
+  auto t1 = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < queries; ++i)
+  {
+    gridSum += grid.sum(bounds[4 * i], bounds[4 * i + 1], bounds[4 * i + 2], bounds[4 * i + 3]);
+  }
+  auto t2 = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < queries; ++i)
+  {
+    for (int r = bounds[4 * i]; r < bounds[4 * i + 2]; ++r)
+    {
+      rowSum += perRow[r].sum(bounds[4 * i + 1], bounds[4 * i + 3]);
+    }
+  }
+  auto t3 = std::chrono::high_resolution_clock::now();
+  CHECK(gridSum == rowSum);
+
+  std::cout << "\n\nMicroseconds for " << queries << " rectangle sums over a " << rows << " x " << cols << " matrix\n";
+  std::cout << "SegmentTree2D:\t\t" << std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() << "\n";
+  std::cout << "SegmentTree per row:\t" << std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count() << "\n";
+}
+
+/*
+ * Testing FenwickTree against SegmentTree through the same sequence of sums and updates.
+ *
+ * Check every size up to 40 and both invertible operations.
+ */
+TEST_CASE("FenwickTree")
+{
+  int mismatches = 0;
+  for (int n = 0; n <= 40; ++n)
+  {
+    std::vector<long> values(n);
+    for (int i = 0; i < n; ++i)
+    {
+      values[i] = (i * 37) % 23 - 11;
+    }
+    FenwickTree<long> fenwick(values.begin(), values.end());
+    SegmentTree<long> tree(values.begin(), values.end());
+    FenwickTree<long, BitXor<long>> xors(values.data(), n);
+    SegmentTree<long, BitXor<long>> treeXors(values.data(), n);
+    for (int step = 0; step < 3; ++step)
+    {
+      for (int l = -1; l <= n + 1; ++l)
+        for (int r = l; r <= n + 1; ++r)
+        {
+          if (fenwick.sum(l, r) != tree.sum(std::max(l, 0), std::min(r, n)))
+            ++mismatches;
+          if (xors.sum(l, r) != treeXors.sum(std::max(l, 0), std::min(r, n)))
+            ++mismatches;
+        }
+      if (n == 0)
+        break;
+      int index = (step * 7) % n;
+      long val = 100 * step - 150;
+      fenwick.update(index, val);
+      tree.update(index, val);
+      xors.update(index, val);
+      treeXors.update(index, val);
+    }
+    int i = 0;
+    for (auto it = fenwick.begin(); it != fenwick.end(); ++it, ++i)
+    {
+      if (*it != *(tree.begin() + i))
+        ++mismatches;
+    }
+    if (i != n || fenwick.size() != n)
+      ++mismatches;
+  }
+  CHECK(mismatches == 0);
+
+  int a[] = {3, 1, 4, 1, 5, 9, 2, 6};
+  FenwickTree<int> digits(a, 8);
+  CHECK(digits.count(1) == 2);
+  CHECK(*digits.find(5) == 5);
+  CHECK(digits.find(7) == digits.end());
+  CHECK(*digits.rbegin() == 6);
+  CHECK(digits.memory_footprint() == 2 * 8 * sizeof(int));
+  digits.update(8, 100);
+  digits.update(-1, 100);
+  CHECK(digits.sum(0, 8) == 31);
+
+  FenwickTree<int> empty;
+  CHECK(empty.empty());
+  CHECK(empty.sum(0, 1) == 0);
+
+  // Floating point sums cannot be taken apart exactly, so FenwickTree<float> does not compile.
+  CHECK(ExactInverse<long, Sum<long>>::value);
+  CHECK(ExactInverse<unsigned, BitXor<unsigned>>::value);
+  CHECK(!ExactInverse<float, Sum<float>>::value);
+  CHECK(!ExactInverse<double, Sum<double>>::value);
+  CHECK(!ExactInverse<int, Min<int>>::value);
+
+  // Nodes may overflow int while every range asked for fits.
+  int big = std::numeric_limits<int>::max() / 2;
+  std::vector<int> halves = {big, big, big, -big, big};
+  FenwickTree<int> wrapping(halves.begin(), halves.end());
+  CHECK(wrapping.sum(0, 2) == 2 * big);
+  CHECK(wrapping.sum(2, 4) == 0);
+  CHECK(wrapping.sum(3, 5) == 0);
+  wrapping.update(3, big);
+  CHECK(wrapping.sum(3, 5) == 2 * big);
+}
+
+/*
+ * Runtime of sums and updates with FenwickTree against SegmentTree in its recursive and
+ * bottom-up layouts.
+ */
+TEST_CASE("FenwickTree Time Complexity")
+{
+  int size = 1 << 20, operations = 1 << 20;
+  std::vector<long> values(size);
+  std::vector<std::pair<int, int>> ranges(operations);
+  for (int i = 0; i < size; ++i)
+  {
+    values[i] = i % 1000;
+  }
+  for (int i = 0; i < operations; ++i)
+  {
+    int l = (i * 7919L) % size, r = (i * 104729L) % size;
+    ranges[i] = {std::min(l, r), std::max(l, r) + 1};
+  }
+  FenwickTree<long> fenwick(values.begin(), values.end());
+  SegmentTree<long> recursive(values.begin(), values.end());
+  SegmentTree<long, Sum<long>, BottomUpLayout> bottomUp(values.begin(), values.end());
+
+  long fenwickSum = 0, recursiveSum = 0, bottomUpSum = 0;
+  auto t1 = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < operations; ++i)
+  {
+    fenwickSum += fenwick.sum(ranges[i].first, ranges[i].second);
+  }
+  auto t2 = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < operations; ++i)
+  {
+    recursiveSum += recursive.sum(ranges[i].first, ranges[i].second);
+  }
+  auto t3 = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < operations; ++i)
+  {
+    bottomUpSum += bottomUp.sum(ranges[i].first, ranges[i].second);
+  }
+  auto t4 = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < operations; ++i)
+  {
+    fenwick.update(ranges[i].first, i % 1000);
+  }
+  auto t5 = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < operations; ++i)
+  {
+    recursive.update(ranges[i].first, i % 1000);
+  }
+  auto t6 = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < operations; ++i)
+  {
+    bottomUp.update(ranges[i].first, i % 1000);
+  }
+  auto t7 = std::chrono::high_resolution_clock::now();
+  CHECK(fenwickSum == recursiveSum);
+  CHECK(fenwickSum == bottomUpSum);
+  CHECK(fenwick.sum(0, size) == recursive.sum(0, size));
+
+  std::cout << "\n\nMicroseconds for " << operations << " sums and " << operations << " updates over " << size << " elements\n";
+  std::cout << "\t\t\tsum\tupdate\tbytes\n";
+  std::cout << "FenwickTree:\t\t" << std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() << "\t"
+            << std::chrono::duration_cast<std::chrono::microseconds>(t5 - t4).count() << "\t" << fenwick.memory_footprint() << "\n";
+  std::cout << "RecursiveLayout:\t" << std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count() << "\t"
+            << std::chrono::duration_cast<std::chrono::microseconds>(t6 - t5).count() << "\t" << recursive.memory_footprint() << "\n";
+  std::cout << "BottomUpLayout:\t\t" << std::chrono::duration_cast<std::chrono::microseconds>(t4 - t3).count() << "\t"
+            << std::chrono::duration_cast<std::chrono::microseconds>(t7 - t6).count() << "\t" << bottomUp.memory_footprint() << "\n";
+}
+
+/*
+ * Testing StaticSegmentTree against SegmentTree on every range, with prefix sums for the
+ * invertible operations and the disjoint sparse table for the others.
+ *
+ * Check every size up to 40, so that every level of the table has blocks cut short by the end.
+ */
+TEST_CASE("StaticSegmentTree")
+{
+  CHECK(is_invertible<Sum<int>>::value);
+  CHECK(is_invertible<BitXor<int>>::value);
+  CHECK(!is_invertible<Min<int>>::value);
+  CHECK(!is_invertible<Concatenate>::value);
+
+  int mismatches = 0;
+  for (int n = 0; n <= 40; ++n)
+  {
+    std::vector<long> values(n);
+    std::vector<float> reals(n);
+    std::vector<std::string> words(n);
+    for (int i = 0; i < n; ++i)
+    {
+      values[i] = (i * 37) % 23 + 1;
+      reals[i] = 100.25f + i % 7;
+      words[i] = std::string(1, 'a' + i % 26);
+    }
+    mismatches += count_static_mismatches<Sum<long>>(values);
+    mismatches += count_static_mismatches<Sum<float>>(reals);
+    mismatches += count_static_mismatches<BitXor<long>>(values);
+    mismatches += count_static_mismatches<Min<long>>(values);
+    mismatches += count_static_mismatches<Max<long>>(values);
+    mismatches += count_static_mismatches<Gcd<long>>(values);
+    mismatches += count_static_mismatches<Concatenate>(words);
+  }
+  CHECK(mismatches == 0);
+
+  std::vector<int> a = {3, 1, 4, 1, 5, 9, 2, 6};
+  StaticSegmentTree<int, Min<int>> minimums(a.begin(), a.end());
+  CHECK(minimums.size() == 8);
+  CHECK(*minimums.begin() == 3);
+  CHECK(minimums.sum(-5, 50) == 1);
+  CHECK(minimums.sum(4, 8) == 2);
+  CHECK(minimums.memory_footprint() == (8 + 3 * 8) * sizeof(int));
+  StaticSegmentTree<int> sums(a.data(), 8);
+  CHECK(sums.memory_footprint() == (8 + 9) * sizeof(int));
+
+  // Floating point sums use the sparse table, as the difference of two large prefixes would round.
+  std::vector<float> reals(1 << 20);
+  for (int i = 0; i < int(reals.size()); ++i)
+  {
+    reals[i] = 100.25f + i % 7;
+  }
+  StaticSegmentTree<float> realSums(reals.begin(), reals.end());
+  int last = reals.size();
+  CHECK(realSums.sum(last - 2, last) == reals[last - 2] + reals[last - 1]);
+
+  // Prefix sums may overflow int while every range asked for fits.
+  int big = std::numeric_limits<int>::max() / 2;
+  std::vector<int> halves = {big, big, big, -big, big};
+  StaticSegmentTree<int> wrapping(halves.begin(), halves.end());
+  CHECK(wrapping.sum(0, 2) == 2 * big);
+  CHECK(wrapping.sum(2, 4) == 0);
+  CHECK(wrapping.sum(3, 5) == 0);
+
+  StaticSegmentTree<int, Max<int>> empty;
+  CHECK(empty.empty());
+  CHECK(empty.sum(0, 1) == std::numeric_limits<int>::lowest());
+}
+
+/*
+ * Runtime of sums with StaticSegmentTree against SegmentTree, for Sum (prefix sums) and
+ * Min (disjoint sparse table).
+ */
+TEST_CASE("StaticSegmentTree Time Complexity")
+{
+  int size = 1 << 20, queries = 1 << 20;
+  std::vector<int> values(size);
+  std::vector<std::pair<int, int>> ranges(queries);
+  for (int i = 0; i < size; ++i)
+  {
+    values[i] = (i * 7919L) % 1000;
+  }
+  for (int i = 0; i < queries; ++i)
+  {
+    int l = (i * 7919L) % size, r = (i * 104729L) % size;
+    ranges[i] = {std::min(l, r), std::max(l, r) + 1};
+  }
+
+  auto t1 = std::chrono::high_resolution_clock::now();
+  StaticSegmentTree<int> staticSums(values.begin(), values.end());
+  StaticSegmentTree<int, Min<int>> staticMins(values.begin(), values.end());
+  auto t2 = std::chrono::high_resolution_clock::now();
+  SegmentTree<int> sums(values.begin(), values.end());
+  SegmentTree<int, Min<int>> mins(values.begin(), values.end());
+  auto t3 = std::chrono::high_resolution_clock::now();
+
+  long staticSum = 0, treeSum = 0;
+  int staticMin = 0, treeMin = 0;
+  auto t4 = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < queries; ++i)
+  {
+    staticSum += staticSums.sum(ranges[i].first, ranges[i].second);
+  }
+  auto t5 = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < queries; ++i)
+  {
+    treeSum += sums.sum(ranges[i].first, ranges[i].second);
+  }
+  auto t6 = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < queries; ++i)
+  {
+    staticMin += staticMins.sum(ranges[i].first, ranges[i].second);
+  }
+  auto t7 = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < queries; ++i)
+  {
+    treeMin += mins.sum(ranges[i].first, ranges[i].second);
+  }
+  auto t8 = std::chrono::high_resolution_clock::now();
+  CHECK(staticSum == treeSum);
+  CHECK(staticMin == treeMin);
+
+  std::cout << "\n\nMicroseconds for " << queries << " range queries over " << size << " elements\n";
+  std::cout << "Build StaticSegmentTree (Sum and Min):\t" << std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() << "\n";
+  std::cout << "Build SegmentTree (Sum and Min):\t" << std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count() << "\n";
+  std::cout << "StaticSegmentTree Sum:\t\t\t" << std::chrono::duration_cast<std::chrono::microseconds>(t5 - t4).count() << "\n";
+  std::cout << "SegmentTree Sum:\t\t\t" << std::chrono::duration_cast<std::chrono::microseconds>(t6 - t5).count() << "\n";
+  std::cout << "StaticSegmentTree Min:\t\t\t" << std::chrono::duration_cast<std::chrono::microseconds>(t7 - t6).count() << "\n";
+  std::cout << "SegmentTree Min:\t\t\t" << std::chrono::duration_cast<std::chrono::microseconds>(t8 - t7).count() << "\n";
+}
+
+TEST_CASE("Time Complexity")
+{
+  long int size = 100000;
+  std::vector<long int> a(size);
+  for (long int i = 0; i < size; ++i)
+  {
+    a[i] = i;
+  }
+  SegmentTree<long int> segmentTree1(a.begin(), a.end());
+  print_time(a, segmentTree1, 0, size);
+  print_time(a, segmentTree1, 0, size / 2);
+  print_time(a, segmentTree1, 0, size / 4);
+  print_time(a, segmentTree1, 0, size / 8);
+  print_time(a, segmentTree1, 0, size / 16);
+  print_time(a, segmentTree1, 0, size / 32);
+  print_time(a, segmentTree1, 0, size / 64);
+  print_time(a, segmentTree1, 0, size / 128);
+  print_time(a, segmentTree1, 1250, 3000);
+  print_time(a, segmentTree1, 1250, 1254);
+}
+
+template <typename T>
+void print_time(std::vector<T> &vect, SegmentTree<T> &seg, long int l, long int r)
+{
+  auto t1 = std::chrono::high_resolution_clock::now();
+
+  T stSum = seg.sum(l, r);
+
+  auto t2 = std::chrono::high_resolution_clock::now();
+  auto stDuration = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+
+  t1 = std::chrono::high_resolution_clock::now();
+
+  long int init = 0;
+  T vectSum = ::accumulate(vect.begin() + l, vect.begin() + r, init);
+
+  t2 = std::chrono::high_resolution_clock::now();
+  auto vectDuration = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+
+  std::cout << "\n\nMicroseconds taken to find sum of an array in range[" << l << ", " << r << "]\n";
+
+  std::cout << "Linear:\t" << vectDuration << "\t| Sum:\t" << vectSum << "\n";
+  std::cout << "S_tree:\t" << stDuration << "\t| Sum:\t" << stSum << "\n";
+}
+
+template <typename T, typename ptr_t>
+T accumulate(ptr_t first, ptr_t last, T init)
+{
+  while (first != last)
+  {
+    init = init + *first;
+    ++first;
+  }
+  return init;
+}
+
+template <typename Op, typename Layout, typename T>
+void check_operation(std::vector<T> values)
+{
+  int n = values.size();
+  SegmentTree<T, Op, Layout> tree(values.begin(), values.end());
+  for (int round = 0; round < 2; ++round)
+  {
+    for (int l = 0; l <= n; ++l)
+    {
+      T expected = Op::identity();
+      CHECK(tree.sum(l, l) == expected);
+      for (int r = l + 1; r <= n; ++r)
+      {
+        expected = Op::combine(expected, values[r - 1]);
+        CHECK(tree.sum(l, r) == expected);
+      }
+    }
+    for (int i = 0; i < n; i += 5)
+    {
+      values[i] = values[(i * 7 + 3) % n];
+      tree.update(i, values[i]);
+    }
+  }
+}
+
+template <typename Op, typename Layout>
+void check_sum_batch(const std::vector<int> &values)
+{
+  int n = values.size();
+  SegmentTree<int, Op, Layout> tree(values.begin(), values.end());
+  std::vector<std::pair<int, int>> ranges;
+  for (int l = n; l >= 0; l -= 3)
+    for (int r = 0; r <= n; r += 2)
+      ranges.push_back(std::make_pair(l, r));
+  std::vector<int> results(ranges.size());
+  tree.sum_batch(ranges.data(), ranges.size(), results.data());
+  for (size_t i = 0; i < ranges.size(); ++i)
+  {
+    CHECK(results[i] == tree.sum(ranges[i].first, ranges[i].second));
+  }
+}
+
+template <typename Tree>
+void print_batch_time(Tree &seg, const std::vector<std::pair<int, int>> &ranges, const char *name)
+{
+  std::vector<long int> loopSums(ranges.size()), batchSums(ranges.size());
+
+  auto t1 = std::chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < ranges.size(); ++i)
+  {
+    loopSums[i] = seg.sum(ranges[i].first, ranges[i].second);
+  }
+  auto t2 = std::chrono::high_resolution_clock::now();
+  auto loopDuration = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+
+  t1 = std::chrono::high_resolution_clock::now();
+  seg.sum_batch(ranges.data(), ranges.size(), batchSums.data());
+  t2 = std::chrono::high_resolution_clock::now();
+  auto batchDuration = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+
+  CHECK(loopSums == batchSums);
+  std::cout << "\n\nMicroseconds taken to find " << ranges.size() << " range sums with " << name << "\n";
+  std::cout << "sum loop:\t" << loopDuration << "\n";
+  std::cout << "sum_batch:\t" << batchDuration << "\n";
+}
+
+template <typename Op, typename Layout>
+void check_update_batch(int n)
+{
+  std::vector<int> a(n);
+  for (int i = 0; i < n; ++i)
+  {
+    a[i] = i % 5;
+  }
+  SegmentTree<int, Op, Layout> batched(a.begin(), a.end()), single(a.begin(), a.end());
+  // Batches of a single update, so that every leaf depth is walked up on its own.
+  for (int i = 0; i < n; ++i)
+  {
+    std::pair<int, int> update(i, i % 7 - 3);
+    batched.update_batch(&update, 1);
+    single.update(i, i % 7 - 3);
+  }
+  for (int round = 1; round <= 3; ++round)
+  {
+    std::vector<std::pair<int, int>> updates;
+    for (int i = 0; i < n * round / 2 + 1; ++i)
+    {
+      updates.push_back(std::make_pair((i * 11 + round) % (n + 1), i * round % 13 - 6));
+    }
+    updates.push_back(std::make_pair(-1, 100));
+    batched.update_batch(updates.data(), updates.size());
+    for (size_t i = 0; i < updates.size(); ++i)
+    {
+      single.update(updates[i].first, updates[i].second);
+    }
+    typename SegmentTree<int, Op, Layout>::iterator b_first = batched.begin(), s_first = single.begin();
+    while (s_first != single.end())
+    {
+      CHECK(*b_first == *s_first);
+      ++b_first;
+      ++s_first;
+    }
+    for (int l = 0; l <= n; ++l)
+      for (int r = l; r <= n; ++r)
+        CHECK(batched.sum(l, r) == single.sum(l, r));
+  }
+}
+
+template <typename Op, typename Layout>
+void check_parallel_build(int n)
+{
+  std::vector<long> a(n);
+  for (int i = 0; i < n; ++i)
+  {
+    a[i] = (i * 7919L) % 1009 - 504;
+  }
+  SegmentTree<long, Op, Layout> serial(a.begin(), a.end());
+  int threads[] = {2, 3, 8};
+  for (int t : threads)
+  {
+    SegmentTree<long, Op, Layout> fromArray(a.data(), n, t), fromRange(a.begin(), a.end(), t);
+    typename SegmentTree<long, Op, Layout>::iterator s_first = serial.begin(), a_first = fromArray.begin(), r_first = fromRange.begin();
+    int mismatches = 0;
+    while (s_first != serial.end())
+    {
+      mismatches += (*a_first != *s_first) + (*r_first != *s_first);
+      ++s_first;
+      ++a_first;
+      ++r_first;
+    }
+    CHECK(mismatches == 0);
+    for (int r = 0; r <= n; r += 1 + r / 64)
+    {
+      CHECK(fromArray.sum(0, r) == serial.sum(0, r));
+      CHECK(fromRange.sum(r / 2, r) == serial.sum(r / 2, r));
+      CHECK(fromArray.sum(r, n) == serial.sum(r, n));
+    }
+  }
+}
+
+template <typename Op, typename Layout>
+void check_parallel_sum_batch(int n)
+{
+  std::vector<long> a(n);
+  for (int i = 0; i < n; ++i)
+  {
+    a[i] = (i * 7919L) % 1009 - 504;
+  }
+  const SegmentTree<long, Op, Layout> tree(a.begin(), a.end());
+  std::vector<std::pair<int, int>> ranges;
+  for (int i = 0; i < 20000; ++i)
+  {
+    ranges.push_back(std::make_pair((i * 7919L) % (n + 1), (i * 104729L) % (n + 1)));
+  }
+  SegmentTree<long, Op, Layout> serial(a.begin(), a.end());
+  std::vector<long> expected(ranges.size());
+  serial.sum_batch(ranges.data(), ranges.size(), expected.data());
+
+  int threads[] = {1, 2, 3, 8};
+  for (int t : threads)
+  {
+    std::vector<long> results(ranges.size());
+    tree.parallel_sum_batch(ranges.data(), ranges.size(), results.data(), t);
+    CHECK(results == expected);
+  }
+
+  ThreadPool pool(4);
+  std::vector<long> fromPool(ranges.size()), first(ranges.size()), second(ranges.size());
+  tree.parallel_sum_batch(ranges.data(), ranges.size(), fromPool.data(), pool);
+  CHECK(fromPool == expected);
+
+  std::thread reader([&] { tree.parallel_sum_batch(ranges.data(), ranges.size(), first.data(), pool); });
+  tree.parallel_sum_batch(ranges.data(), ranges.size(), second.data(), 4);
+  reader.join();
+  CHECK(first == expected);
+  CHECK(second == expected);
+}
+
+template <typename Op, typename Layout>
+void check_mapped(int n, const std::string &path)
+{
+  std::vector<long> a(n);
+  for (int i = 0; i < n; ++i)
+  {
+    a[i] = (i * 7919L) % 1000 - 500;
+  }
+  SegmentTree<long, Op, Layout> tree(a.begin(), a.end());
+  REQUIRE(tree.save(path));
+
+  MappedSegmentTree<long, Op, Layout> mapped(path);
+  CHECK(mapped.size() == n);
+  CHECK(mapped.verify());
+  int mismatches = 0, i = 0;
+  for (auto it = mapped.begin(); it != mapped.end(); ++it, ++i)
+  {
+    if (*it != a[i])
+      ++mismatches;
+  }
+  CHECK(i == n);
+  for (int l = 0; l <= n; l += 7)
+  {
+    for (int r = l; r <= n; r += 13)
+    {
+      if (mapped.sum(l, r) != tree.sum(l, r))
+        ++mismatches;
+    }
+  }
+  CHECK(mismatches == 0);
+  CHECK(!mapped.writable());
+  mapped.update(0, 12345);
+  CHECK(mapped.sum(0, n) == tree.sum(0, n));
+
+  if (n > 0)
+  {
+    MappedSegmentTree<long, Op, Layout> writable(path, true);
+    writable.update(n / 2, 12345);
+    tree.update(n / 2, 12345);
+    CHECK(writable.sum(0, n) == tree.sum(0, n));
+    CHECK(writable.sum(n / 2, n / 2 + 1) == 12345);
+    CHECK(!writable.verify());
+    MappedSegmentTree<long, Op, Layout> reopened(path);
+    CHECK(reopened.verify());
+    CHECK(reopened.sum(n / 2, n / 2 + 1) == a[n / 2]);
+
+    MappedSegmentTree<long, Op, Layout> moved(std::move(reopened));
+    CHECK(reopened.empty());
+    CHECK(moved.size() == n);
+  }
+}
+
+template <typename Op, typename Layout>
+void check_save_load(int n)
+{
+  std::vector<long> a(n);
+  for (int i = 0; i < n; ++i)
+  {
+    a[i] = (i * 7919L) % 1000 - 500;
+  }
+  SegmentTree<long, Op, Layout> tree(a.begin(), a.end());
+  std::stringstream saved;
+  REQUIRE(tree.save(saved));
+  std::string bytes = saved.str();
+
+  // An equal tree saves the same bytes, whatever its allocation held before.
+  {
+    std::vector<unsigned char> garbage(std::size_t(Layout::node_count(n) + n) * sizeof(long), 0xCD);
+    REQUIRE(garbage.empty() == (n == 0));
+  }
+  std::stringstream savedAgain;
+  REQUIRE((SegmentTree<long, Op, Layout>(a.begin(), a.end()).save(savedAgain)));
+  CHECK(savedAgain.str() == bytes);
+
+  // The same tree as saved by a machine of the other byte order.
+  FileHeader header;
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  std::string swapped = bytes;
+  detail::byteswap_values(&swapped[sizeof(header)], (swapped.size() - sizeof(header)) / sizeof(long), sizeof(long));
+  const long *swappedTree = reinterpret_cast<const long *>(&swapped[sizeof(header)]);
+  header.checksum = detail::payload_checksum<long, Layout>(swappedTree, Layout::stores_leaves ? nullptr : swappedTree + Layout::node_count(n), n);
+  detail::byteswap_header(header);
+  std::memcpy(&swapped[0], &header, sizeof(header));
+
+  for (const std::string &stream : {bytes, swapped})
+  {
+    SegmentTree<long, Op, Layout> loaded(a.begin(), a.begin() + n / 2);
+    std::istringstream in(stream);
+    REQUIRE(loaded.load(in));
+    CHECK(loaded.size() == n);
+    int mismatches = 0, i = 0;
+    for (auto it = loaded.begin(); it != loaded.end(); ++it, ++i)
+    {
+      if (*it != a[i])
+        ++mismatches;
+    }
+    for (int l = 0; l <= n; l += 7)
+    {
+      for (int r = l; r <= n; r += 13)
+      {
+        if (loaded.sum(l, r) != tree.sum(l, r))
+          ++mismatches;
+      }
+    }
+    CHECK(mismatches == 0);
+    std::stringstream resaved;
+    REQUIRE(loaded.save(resaved));
+    CHECK(resaved.str() == bytes);
+    if (n > 0)
+    {
+      loaded.update(n / 2, 12345);
+      CHECK(loaded.sum(n / 2, n / 2 + 1) == 12345);
+      std::vector<long> b = a;
+      b[n / 2] = 12345;
+      SegmentTree<long, Op, Layout> rebuilt(b.begin(), b.end());
+      CHECK(loaded.sum(0, n) == rebuilt.sum(0, n));
+    }
+  }
+}
+
+/*
+ * Counts the ranges, empty and out of bounds ones included, on which a StaticSegmentTree
+ * disagrees with a SegmentTree of the same operation.
+ */
+template <typename Op, typename T>
+int count_static_mismatches(const std::vector<T> &values)
+{
+  int n = values.size(), mismatches = 0;
+  StaticSegmentTree<T, Op> frozen(values.begin(), values.end());
+  SegmentTree<T, Op> tree(values.begin(), values.end());
+  if (frozen.size() != n)
+    ++mismatches;
+  for (int l = -1; l <= n + 1; ++l)
+  {
+    for (int r = l; r <= n + 1; ++r)
+    {
+      if (!(frozen.sum(l, r) == tree.sum(std::max(l, 0), std::min(r, n))))
+        ++mismatches;
+    }
+  }
+  return mismatches;
 }